@@ -0,0 +1,229 @@
+#include "symbolic.h"
+#include "symbolic_internal.h"
+#include <cmath>
+#include <unordered_map>
+
+namespace {
+
+struct Linear {
+	bool linear;
+	float a;
+	float b;
+};
+
+/*
+	Integrates by linearity, sums and vectors term by term and constant
+	factors out, with a rule per function for the remaining terms. Both the
+	walk over the terms and the matching of linear arguments use explicit
+	stacks, and linear matches are remembered so every node is matched once.
+*/
+class Antiderivative {
+public:
+	std::shared_ptr<Node> run(const std::shared_ptr<Node> &root) {
+		std::vector<std::pair<const std::shared_ptr<Node>*, size_t>> frames{{&root, 0}};
+		std::vector<std::shared_ptr<Node>> results;
+		while (!frames.empty()) {
+			auto &frame = frames.back();
+			auto &node = *frame.first;
+			size_t count = termCount(node);
+			if (frame.second < count) {
+				frames.push_back({&term(node, frame.second++), 0});
+				continue;
+			}
+			frames.pop_back();
+			auto integral = combine(node, results.data() + results.size() - count);
+			results.resize(results.size() - count);
+			results.push_back(std::move(integral));
+		}
+		return results.back();
+	}
+
+private:
+	/*
+		Matches a * x + b, the only arguments for which substitution is applied
+		∫ f(a * x + b) dx = F(a * x + b) / a
+	*/
+	bool isLinear(const std::shared_ptr<Node> &node, float &a, float &b) {
+		if (!fLinear.count(node.get())) {
+			// Only sums and products of linear terms are linear, no need to look further
+			std::vector<std::pair<const std::shared_ptr<Node>*, size_t>> frames{{&node, 0}};
+			while (!frames.empty()) {
+				auto &frame = frames.back();
+				auto &current = *frame.first;
+				size_t count = isSum(current) || isProduct(current) ? 2 : 0;
+				if (frame.second < count) {
+					auto &child = current->getChild(frame.second++);
+					if (!fLinear.count(child.get())) {
+						frames.push_back({&child, 0});
+					}
+					continue;
+				}
+				frames.pop_back();
+				fLinear[current.get()] = linearLocal(current);
+			}
+		}
+		auto &linear = fLinear[node.get()];
+		a = linear.a;
+		b = linear.b;
+		return linear.linear;
+	}
+
+	// Given that the children are matched already
+	Linear linearLocal(const std::shared_ptr<Node> &node) {
+		if (isConstant(node)) {
+			return {true, 0.0f, toConstant(node)->fValue};
+		}
+		if (isVariable(node)) {
+			return {true, 1.0f, 0.0f};
+		}
+		if (isSum(node)) {
+			auto sum = toSum(node);
+			auto &left = fLinear[sum->fLeft.get()];
+			auto &right = fLinear[sum->fRight.get()];
+			return {left.linear && right.linear, left.a + right.a, left.b + right.b};
+		}
+		if (isProduct(node)) {
+			auto product = toProduct(node);
+			auto &left = fLinear[product->fLeft.get()];
+			auto &right = fLinear[product->fRight.get()];
+			if (!left.linear || !right.linear) {
+				return {false, 0.0f, 0.0f};
+			}
+			// Only a constant times a linear expression stays linear
+			if (left.a == 0.0f) {
+				return {true, left.b * right.a, left.b * right.b};
+			}
+			if (right.a == 0.0f) {
+				return {true, right.b * left.a, right.b * left.b};
+			}
+		}
+		return {false, 0.0f, 0.0f};
+	}
+
+	bool isConstantFactor(const std::shared_ptr<Node> &node) {
+		float a, b;
+		return isLinear(node, a, b) && a == 0.0f;
+	}
+
+	// Number of terms integrated separately, whose integrals combine() puts together
+	size_t termCount(const std::shared_ptr<Node> &node) {
+		float a, b;
+		if (isLinear(node, a, b)) {
+			return 0;
+		}
+		if (isVector(node)) {
+			return toVector(node)->getDimension();
+		}
+		if (isSum(node)) {
+			return 2;
+		}
+		if (isProduct(node)) {
+			auto product = toProduct(node);
+			return isConstantFactor(product->fLeft) || isConstantFactor(product->fRight) ? 1 : 0;
+		}
+		return 0;
+	}
+
+	const std::shared_ptr<Node> &term(const std::shared_ptr<Node> &node, size_t index) {
+		if (isProduct(node)) {
+			auto product = toProduct(node);
+			return isConstantFactor(product->fLeft) ? product->fRight : product->fLeft;
+		}
+		return node->getChild(index);
+	}
+
+	std::shared_ptr<Node> combine(const std::shared_ptr<Node> &node, const std::shared_ptr<Node> *integrals) {
+		float a, b;
+		if (isLinear(node, a, b)) {
+			// ∫ (a * x + b) dx = a / 2 * x ^ 2 + b * x
+			auto x = newVariable();
+			if (a == 0.0f) {
+				return newProduct(newConstant(b), x);
+			}
+			return newSum(newProduct(newConstant(0.5f * a), newPower(x, newConstant(2.0f))), newProduct(newConstant(b), x));
+		}
+		if (isVector(node)) {
+			return newVector(std::vector<std::shared_ptr<Node>>(integrals, integrals + toVector(node)->getDimension()));
+		}
+		if (isSum(node)) {
+			// ∫ (f + g) dx = ∫ f dx + ∫ g dx
+			return newSum(integrals[0], integrals[1]);
+		}
+		if (isProduct(node)) {
+			// ∫ c * f dx = c * ∫ f dx
+			auto product = toProduct(node);
+			if (isConstantFactor(product->fLeft)) {
+				return newProduct(product->fLeft, integrals[0]);
+			}
+			if (isConstantFactor(product->fRight)) {
+				return newProduct(product->fRight, integrals[0]);
+			}
+		}
+		if (isPower(node)) {
+			auto power = toPower(node);
+			if (isConstant(power->fExponent) && isLinear(power->fBase, a, b) && a != 0.0f) {
+				float exponent = toConstant(power->fExponent)->fValue;
+				if (exponent == -1.0f) {
+					// ∫ u ^ -1 dx = ln(abs(u)) / a
+					return divide(newNaturalLogarithm(newFunction(FunctionKind::AbsoluteValue, power->fBase)), a);
+				}
+				// ∫ u ^ n dx = u ^ (n + 1) / ((n + 1) * a)
+				return divide(newPower(power->fBase, newConstant(exponent + 1.0f)), (exponent + 1.0f) * a);
+			}
+			if (isConstant(power->fBase) && toConstant(power->fBase)->fValue > 0.0f && toConstant(power->fBase)->fValue != 1.0f &&
+				isLinear(power->fExponent, a, b) && a != 0.0f) {
+				// ∫ c ^ u dx = c ^ u / (a * ln(c))
+				return divide(node, a * logf(toConstant(power->fBase)->fValue));
+			}
+		}
+		if (isSine(node) && isLinear(toSine(node)->fArgument, a, b) && a != 0.0f) {
+			// ∫ sin(u) dx = -cos(u) / a
+			return divide(newCosine(toSine(node)->fArgument), -a);
+		}
+		if (isCosine(node) && isLinear(toCosine(node)->fArgument, a, b) && a != 0.0f) {
+			// ∫ cos(u) dx = sin(u) / a
+			return divide(newSine(toCosine(node)->fArgument), a);
+		}
+		if (isExponential(node) && isLinear(toExponential(node)->fArgument, a, b) && a != 0.0f) {
+			// ∫ exp(u) dx = exp(u) / a
+			return divide(node, a);
+		}
+		return newIntegral(node);
+	}
+
+	// F(u) / a, dropping the division when a is one
+	std::shared_ptr<Node> divide(std::shared_ptr<Node> node, float a) {
+		if (a == 1.0f) {
+			return node;
+		}
+		return newProduct(newConstant(1.0f / a), std::move(node));
+	}
+
+	std::unordered_map<const Node*, Linear> fLinear;
+};
+
+}
+
+std::shared_ptr<Node> antiderivative(const std::shared_ptr<Node> &node) {
+	return Antiderivative().run(node);
+}
+
+NodeRef NodeRef::integrate() {
+	SYMBOLIC_TRACE("integrate");
+	return NodeRef(antiderivative(simplify().fRef));
+}
+
+bool containsIntegral(const NodeRef &node) {
+	std::vector<Node*> pending{node.fRef.get()};
+	while (!pending.empty()) {
+		auto n = pending.back();
+		pending.pop_back();
+		if (dynamic_cast<Integral*>(n)) {
+			return true;
+		}
+		for (size_t i = 0; i < n->getChildCount(); i++) {
+			pending.push_back(n->getChild(i).get());
+		}
+	}
+	return false;
+}
@@ -0,0 +1,222 @@
+#include "symbolic.h"
+#include "symbolic_internal.h"
+#include "static_expression.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+
+/*
+	Benchmarks derive, simplify and evaluate over generated expression
+	families. Allocations are counted by replacing the global operator new,
+	which also tracks the live heap size to report peak memory per operation.
+*/
+
+static std::atomic<size_t> allocations{0};
+static std::atomic<size_t> liveBytes{0};
+static std::atomic<size_t> peakBytes{0};
+
+// Allocations carry their size in front so delete can update liveBytes
+static constexpr size_t kHeader = alignof(std::max_align_t);
+
+void *operator new(size_t size) {
+	auto block = static_cast<char*>(std::malloc(size + kHeader));
+	if (!block) {
+		throw std::bad_alloc();
+	}
+	*reinterpret_cast<size_t*>(block) = size;
+	allocations++;
+	size_t live = liveBytes += size;
+	size_t peak = peakBytes;
+	while (live > peak && !peakBytes.compare_exchange_weak(peak, live)) {}
+	return block + kHeader;
+}
+
+void operator delete(void *pointer) noexcept {
+	if (pointer) {
+		auto block = static_cast<char*>(pointer) - kHeader;
+		liveBytes -= *reinterpret_cast<size_t*>(block);
+		std::free(block);
+	}
+}
+
+void operator delete(void *pointer, size_t) noexcept {
+	operator delete(pointer);
+}
+
+struct Measurement {
+	double nanoseconds;	// Per call
+	double allocations;	// Per call
+	size_t peakBytes;	// Above the live heap at the start
+};
+
+// Repeats f for at least 50ms
+static Measurement measure(const std::function<void()> &f) {
+	using Clock = std::chrono::steady_clock;
+	size_t baseAllocations = allocations;
+	size_t baseBytes = liveBytes;
+	peakBytes = baseBytes;
+	size_t calls = 0;
+	auto start = Clock::now();
+	auto end = start;
+	do {
+		f();
+		calls++;
+		end = Clock::now();
+	} while (end - start < std::chrono::milliseconds(50));
+	double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+	return {nanoseconds / calls, static_cast<double>(allocations - baseAllocations) / calls, peakBytes - baseBytes};
+}
+
+// ((((x + 1) * x + 2) * x + 3) ...), a left deep chain
+static NodeRef deepChain(int depth) {
+	auto x = variable();
+	auto n = x;
+	for (int i = 1; i <= depth; i++) {
+		n = (i % 2 ? n + constant(i) : n * x);
+	}
+	return n;
+}
+
+// c0 + c1 * x + c2 * x ^ 2 + ...
+static NodeRef wideSum(int terms) {
+	auto x = variable();
+	auto n = constant(1.0f);
+	for (int i = 1; i < terms; i++) {
+		n = n + (1.0f / i) * (x ^ static_cast<float>(i));
+	}
+	return n;
+}
+
+// sin(cos(... ^ 2) ^ 2), nesting powers and functions
+static NodeRef nested(int depth) {
+	auto x = variable();
+	auto n = x;
+	for (int i = 0; i < depth; i++) {
+		n = (i % 2 ? sin(n) : cos(n)) ^ 2;
+	}
+	return n;
+}
+
+// dot product of two vectors with dimension elements
+static NodeRef dotProduct(int dimension) {
+	auto x = variable();
+	std::vector<std::shared_ptr<Node>> a, b;
+	for (int i = 0; i < dimension; i++) {
+		a.push_back((static_cast<float>(i) * x).fRef);
+		b.push_back((x ^ constant(i % 4)).fRef);
+	}
+	return dot(NodeRef(newVector(std::move(a))), NodeRef(newVector(std::move(b))));
+}
+
+static void run(const std::string &family, int size, const std::function<NodeRef()> &build) {
+	auto n = build();
+	size_t nodes = n.size();
+	auto construct = measure([&]() { build(); });
+	float sink = 0.0f;
+	auto evaluate = measure([&]() { sink += n.evaluate(0.7f); });
+
+	std::vector<float> points(1024, 0.7f), results(points.size());
+	auto batch = measure([&]() { n.evaluate(points.data(), results.data(), points.size()); });
+
+	auto derivative = n.derive();
+	size_t derivativeNodes = derivative.size();
+	auto derive = measure([&]() { n.derive(); });
+	auto simplify = measure([&]() { derivative.simplify(); });
+
+	std::ostringstream stream;
+	auto out = measure([&]() { stream.str(std::string()); stream << derivative; });
+	Printer printer;
+	auto print = measure([&]() { printer.print(derivative); });
+
+	std::printf("%-10s %6d %8zu %10.2f %10.2f %12.1f %10.2f %10.2f %10.2f %10.1f %12.1f %12zu %10.1f %12.1f %10.2f %10.2f %12.1f\n",
+		family.c_str(), size, nodes,
+		construct.nanoseconds / nodes, construct.allocations / nodes,
+		evaluate.nanoseconds, batch.nanoseconds / points.size(),
+		derive.nanoseconds / nodes, derive.allocations / nodes,
+		simplify.nanoseconds / derivativeNodes, simplify.allocations, simplify.peakBytes,
+		evaluate.allocations, batch.allocations,
+		out.nanoseconds / derivativeNodes, print.nanoseconds / derivativeNodes, print.allocations);
+	if (sink == 1234.5f) {
+		std::printf("\n");
+	}
+}
+
+int main() {
+	std::printf("%-10s %6s %8s %10s %10s %12s %10s %10s %10s %10s %12s %12s %10s %12s %10s %10s %12s\n",
+		"family", "size", "nodes",
+		"build ns", "bld alloc",
+		"eval ns", "batch ns", "derive ns", "der alloc",
+		"simp ns", "simp alloc", "simp peak",
+		"eval alloc", "batch alloc",
+		"out ns", "print ns", "print alloc");
+	std::printf("%-10s %6s %8s %10s %10s %12s %10s %10s %10s %10s %12s %12s %10s %12s %10s %10s %12s\n",
+		"", "", "",
+		"/node", "/node",
+		"/call", "/point", "/node", "/node",
+		"/node", "/call", "bytes",
+		"/call", "/call",
+		"/node", "/node", "/call");
+	for (int size : {16, 64, 256}) {
+		run("chain", size, [size]() { return deepChain(size); });
+	}
+	for (int size : {16, 64, 256}) {
+		run("sum", size, [size]() { return wideSum(size); });
+	}
+	for (int size : {2, 4, 6}) {
+		run("nested", size, [size]() { return nested(size); });
+	}
+	for (int size : {16, 64, 256}) {
+		run("dot", size, [size]() { return dotProduct(size); });
+	}
+
+	// A formula fixed at compile time, interpreted and as a static expression
+	constexpr StaticVariable x;
+	auto f = staticConstant<3> * (x ^ staticConstant<4>) + staticConstant<2> * x * x + sin(x) * exp(x);
+	auto df = derive(f);
+	auto n = toNodeRef(f);
+	auto dn = n.derive().simplify();
+	float sink = 0.0f;
+	auto dynamic = measure([&]() { sink += n.evaluate(0.7f) + dn.evaluate(0.7f); });
+	auto fixed = measure([&]() { sink += f(0.7f) + df(0.7f); });
+	std::printf("formula and derivative: NodeRef %.1f ns, static %.1f ns\n", dynamic.nanoseconds, fixed.nanoseconds);
+
+	// Newton from many starting points, batched and one point at a time
+	auto g = toNodeRef(f) - constant(5.0f);
+	std::vector<float> starts(4096);
+	for (size_t i = 0; i < starts.size(); i++) {
+		starts[i] = -2.0f + 4.0f * i / starts.size();
+	}
+	auto batched = measure([&]() { sink += solve(g, starts)[0].root; });
+	auto scalar = measure([&]() {
+		auto dg = g.derive().simplify();
+		for (float start : starts) {
+			float v = start;
+			for (int i = 0; i < 50; i++) {
+				float step = g.evaluate(v) / dg.evaluate(v);
+				v -= step;
+				if (!std::isfinite(step) || std::abs(step) <= 1e-6f * std::max(1.0f, std::abs(v))) {
+					break;
+				}
+			}
+			sink += v;
+		}
+	});
+	std::printf("newton from %zu points: batched %.1f us, scalar %.1f us\n", starts.size(), batched.nanoseconds / 1000.0, scalar.nanoseconds / 1000.0);
+	if (sink == 1234.5f) {
+		std::printf("\n");
+	}
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	std::printf("peak resident memory %ld KB\n", usage.ru_maxrss);
+	return 0;
+}
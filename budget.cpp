@@ -0,0 +1,83 @@
+#include "symbolic.h"
+#include "symbolic_internal.h"
+#include <chrono>
+
+/*
+	Budgets are charged by the node factories, so derive() and simplify()
+	need no changes to respect them. Running out throws BudgetExceeded from
+	inside the factory, unwinding whatever was being built.
+*/
+
+thread_local BudgetScope *gBudgetScope = nullptr;
+
+namespace {
+
+double now() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Reading the clock costs more than creating a node, so only every kClockInterval nodes
+const size_t kClockInterval = 64;
+
+}
+
+BudgetScope::BudgetScope(const Budget &budget) :
+fBudget(budget),
+fDeadline(budget.maxMilliseconds > 0.0f ? now() + budget.maxMilliseconds : 0.0),
+fPrevious(gBudgetScope) {
+	gBudgetScope = this;
+}
+
+BudgetScope::~BudgetScope() {
+	gBudgetScope = fPrevious;
+}
+
+void BudgetScope::charge(const Node &node) {
+	fNodes++;
+	const char *exceeded = nullptr;
+	if (fBudget.maxNodes && fNodes > fBudget.maxNodes) {
+		exceeded = "node budget exceeded";
+	}
+	else if (fBudget.maxDepth && node.depth() > fBudget.maxDepth) {
+		exceeded = "depth budget exceeded";
+	}
+	else if (fDeadline > 0.0 && fNodes % kClockInterval == 0 && now() > fDeadline) {
+		exceeded = "time budget exceeded";
+	}
+	if (exceeded) {
+		fExhausted = true;
+		throw BudgetExceeded(exceeded);
+	}
+}
+
+NodeRef NodeRef::derive(const Budget &budget) {
+	BudgetScope scope(budget);
+	return derive();
+}
+
+/*
+	Each pass runs to completion or is dropped, the last complete pass is
+	always a valid simplification of the original
+*/
+NodeRef NodeRef::simplify(const Budget &budget) {
+	SYMBOLIC_TRACE("simplify");
+	BudgetScope scope(budget);
+	auto prev = fRef;
+	try {
+		auto simplified = simplifyPass(prev);
+		while (!simplified->equals(prev)) {
+			prev = simplified;
+			if (scope.fDeadline > 0.0 && now() > scope.fDeadline) {
+				break;
+			}
+			simplified = simplifyPass(prev);
+		}
+	}
+	catch (const BudgetExceeded&) {
+		// An enclosing budget running out has to unwind further
+		if (!scope.fExhausted) {
+			throw;
+		}
+	}
+	return NodeRef(prev);
+}
@@ -0,0 +1,749 @@
+#include "symbolic.h"
+#include "symbolic_internal.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+/*
+	Equality saturation
+
+	Instead of rewriting the tree in place, every identity adds the rewritten
+	form to an e-graph, where equivalent expressions share an e-class. Since no
+	form is ever lost, the order in which rules fire does not matter. Once
+	saturated (or out of budget) the cheapest form of the root class is
+	extracted using the same cost model as evaluationCost().
+*/
+
+namespace {
+
+enum class Op : uint8_t {
+	Constant,
+	Variable,
+	Opaque,		// Any node the e-graph does not know, kept as is
+	Sum,
+	Product,
+	Power,
+	Function	// Any function of the table, index holding its kind
+};
+
+using ClassId = uint32_t;
+
+struct ENode {
+	Op op;
+	float value{0.0f};	// Constant value
+	uint32_t index{0};	// Opaque index or function kind
+	ClassId children[2]{0, 0};
+
+	size_t arity() const {
+		switch (op) {
+			case Op::Sum:
+			case Op::Product:
+			case Op::Power:
+				return 2;
+			case Op::Function:
+				return 1;
+			default:
+				return 0;
+		}
+	}
+
+	bool operator==(const ENode &other) const {
+		return op == other.op &&
+			std::memcmp(&value, &other.value, sizeof(value)) == 0 &&
+			index == other.index &&
+			children[0] == other.children[0] &&
+			children[1] == other.children[1];
+	}
+};
+
+struct ENodeHash {
+	size_t operator()(const ENode &node) const {
+		uint32_t bits;
+		std::memcpy(&bits, &node.value, sizeof(bits));
+		size_t hash = static_cast<size_t>(node.op);
+		hash = hash * 31 + bits;
+		hash = hash * 31 + node.index;
+		hash = hash * 31 + node.children[0];
+		hash = hash * 31 + node.children[1];
+		return hash;
+	}
+};
+
+struct EClass {
+	std::vector<ENode> nodes;
+	bool isConstant{false};
+	float constant{0.0f};
+};
+
+class EGraph {
+public:
+	ClassId add(ENode node) {
+		canonicalize(node);
+		auto found = fMemo.find(node);
+		if (found != fMemo.end()) {
+			return find(found->second);
+		}
+		ClassId id = static_cast<ClassId>(fParents.size());
+		fParents.push_back(id);
+		fClasses.emplace_back();
+		fClasses[id].nodes.push_back(node);
+		if (node.op == Op::Constant) {
+			fClasses[id].isConstant = true;
+			fClasses[id].constant = node.value;
+		}
+		fMemo.emplace(node, id);
+		fNodeCount++;
+		fChanged = true;
+		return id;
+	}
+
+	ClassId add(Op op, ClassId left, ClassId right = 0) {
+		ENode node{op};
+		node.children[0] = left;
+		node.children[1] = right;
+		return add(node);
+	}
+
+	ClassId addConstant(float value) {
+		ENode node{Op::Constant};
+		node.value = value;
+		return add(node);
+	}
+
+	ClassId addFunction(FunctionKind kind, ClassId argument) {
+		ENode node{Op::Function};
+		node.index = static_cast<uint32_t>(kind);
+		node.children[0] = argument;
+		return add(node);
+	}
+
+	ClassId find(ClassId id) {
+		while (fParents[id] != id) {
+			fParents[id] = fParents[fParents[id]];
+			id = fParents[id];
+		}
+		return id;
+	}
+
+	ClassId merge(ClassId a, ClassId b) {
+		a = find(a);
+		b = find(b);
+		if (a == b) {
+			return a;
+		}
+		// Keep the class with the most nodes as root
+		if (fClasses[a].nodes.size() < fClasses[b].nodes.size()) {
+			std::swap(a, b);
+		}
+		fParents[b] = a;
+		auto &root = fClasses[a];
+		auto &child = fClasses[b];
+		root.nodes.insert(root.nodes.end(), child.nodes.begin(), child.nodes.end());
+		if (!root.isConstant && child.isConstant) {
+			root.isConstant = true;
+			root.constant = child.constant;
+		}
+		child.nodes.clear();
+		child.nodes.shrink_to_fit();
+		fChanged = true;
+		return a;
+	}
+
+	// Restores the congruence invariant: equal nodes live in the same class
+	void rebuild() {
+		bool merged = true;
+		while (merged) {
+			merged = false;
+			fMemo.clear();
+			for (ClassId id = 0; id < fClasses.size(); id++) {
+				if (find(id) != id) {
+					continue;
+				}
+				for (auto &node : fClasses[id].nodes) {
+					canonicalize(node);
+				}
+			}
+			std::vector<std::pair<ClassId, ClassId>> pending;
+			for (ClassId id = 0; id < fClasses.size(); id++) {
+				if (find(id) != id) {
+					continue;
+				}
+				for (auto &node : fClasses[id].nodes) {
+					auto inserted = fMemo.emplace(node, id);
+					if (!inserted.second && inserted.first->second != id) {
+						pending.emplace_back(inserted.first->second, id);
+					}
+				}
+			}
+			for (auto &pair : pending) {
+				if (find(pair.first) != find(pair.second)) {
+					merge(pair.first, pair.second);
+					merged = true;
+				}
+			}
+		}
+		// Drop the duplicates merging left behind
+		for (ClassId id = 0; id < fClasses.size(); id++) {
+			if (find(id) != id) {
+				continue;
+			}
+			auto &nodes = fClasses[id].nodes;
+			std::vector<ENode> unique;
+			for (auto &node : nodes) {
+				if (std::find(unique.begin(), unique.end(), node) == unique.end()) {
+					unique.push_back(node);
+				}
+			}
+			nodes.swap(unique);
+		}
+		fNodeCount = fMemo.size();
+	}
+
+	bool constantOf(ClassId id, float &value) {
+		auto &eclass = fClasses[find(id)];
+		value = eclass.constant;
+		return eclass.isConstant;
+	}
+
+	bool isConstant(ClassId id, float value) {
+		float constant;
+		return constantOf(id, constant) && constant == value;
+	}
+
+	const std::vector<ENode> &nodes(ClassId id) {
+		return fClasses[find(id)].nodes;
+	}
+
+	size_t classCount() const { return fClasses.size(); }
+	size_t nodeCount() const { return fNodeCount; }
+
+	bool fChanged{false};
+
+private:
+	void canonicalize(ENode &node) {
+		for (size_t i = 0; i < node.arity(); i++) {
+			node.children[i] = find(node.children[i]);
+		}
+	}
+
+	std::vector<ClassId> fParents;
+	std::vector<EClass> fClasses;
+	std::unordered_map<ENode, ClassId, ENodeHash> fMemo;
+	size_t fNodeCount{0};
+};
+
+bool isInteger(float value) {
+	return std::isfinite(value) && value == std::floor(value);
+}
+
+bool isSmallInteger(float value) {
+	return value >= 2.0f && value <= 4.0f && value == static_cast<int>(value);
+}
+
+bool fold(EGraph &graph, const ENode &node, float &result) {
+	float a, b;
+	switch (node.op) {
+		case Op::Sum:
+			if (!graph.constantOf(node.children[0], a) || !graph.constantOf(node.children[1], b)) return false;
+			result = a + b;
+			break;
+		case Op::Product:
+			if (!graph.constantOf(node.children[0], a) || !graph.constantOf(node.children[1], b)) return false;
+			result = a * b;
+			break;
+		case Op::Power:
+			if (!graph.constantOf(node.children[0], a) || !graph.constantOf(node.children[1], b)) return false;
+			result = powf(a, b);
+			break;
+		case Op::Function:
+			if (!graph.constantOf(node.children[0], a)) return false;
+			result = functionInfo(static_cast<FunctionKind>(node.index)).evaluate(a);
+			break;
+		default:
+			return false;
+	}
+	return std::isfinite(result);
+}
+
+// True for a function node of the given kind
+bool isKind(const ENode &node, FunctionKind kind) {
+	return node.op == Op::Function && static_cast<FunctionKind>(node.index) == kind;
+}
+
+// True when class id holds a positive constant or an exponential
+bool isPositive(EGraph &graph, ClassId id) {
+	float constant;
+	if (graph.constantOf(id, constant)) {
+		return constant > 0.0f;
+	}
+	for (auto &node : graph.nodes(id)) {
+		if (isKind(node, FunctionKind::Exponential)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Finds f(u) ^ 2 among nodes, where f is the given function, and returns u
+bool findSquare(EGraph &graph, const std::vector<ENode> &nodes, FunctionKind function, ClassId &argument) {
+	for (auto &node : nodes) {
+		if (node.op != Op::Power || !graph.isConstant(node.children[1], 2.0f)) {
+			continue;
+		}
+		for (auto &base : graph.nodes(node.children[0])) {
+			if (isKind(base, function)) {
+				argument = graph.find(base.children[0]);
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+// Applies every rule to a single node of class id, adding nodes up to maxNodes
+void applyRules(EGraph &graph, ClassId id, const ENode &node, size_t maxNodes) {
+	float folded;
+	if (fold(graph, node, folded)) {
+		graph.merge(id, graph.addConstant(folded));
+		return;
+	}
+	ClassId a = node.children[0];
+	ClassId b = node.children[1];
+	// Copies, since adding nodes below may grow these classes
+	std::vector<ENode> leftNodes(graph.nodes(a));
+	std::vector<ENode> rightNodes(graph.nodes(b));
+	// Rules pairing every node of a with every node of b may add many nodes at once
+	auto full = [&graph, maxNodes]() { return graph.nodeCount() >= maxNodes; };
+	switch (node.op) {
+		case Op::Sum: {
+			// a + b = b + a
+			graph.merge(id, graph.add(Op::Sum, b, a));
+			// 0 + a = a
+			if (graph.isConstant(a, 0.0f)) {
+				graph.merge(id, b);
+			}
+			// a + a = 2 * a
+			if (graph.find(a) == graph.find(b)) {
+				graph.merge(id, graph.add(Op::Product, graph.addConstant(2.0f), a));
+			}
+			// (p + q) + b = p + (q + b)
+			for (auto left : leftNodes) {
+				if (left.op == Op::Sum) {
+					graph.merge(id, graph.add(Op::Sum, left.children[0], graph.add(Op::Sum, left.children[1], b)));
+				}
+			}
+			for (auto left : leftNodes) {
+				if (left.op != Op::Product) {
+					continue;
+				}
+				// (p * a) + a = (p + 1) * a
+				if (graph.find(left.children[1]) == graph.find(b)) {
+					graph.merge(id, graph.add(Op::Product, graph.add(Op::Sum, left.children[0], graph.addConstant(1.0f)), b));
+				}
+				// (p * q) + (p * s) = p * (q + s)
+				for (auto right : rightNodes) {
+					if (full()) return;
+					if (right.op == Op::Product && graph.find(left.children[0]) == graph.find(right.children[0])) {
+						graph.merge(id, graph.add(Op::Product, left.children[0], graph.add(Op::Sum, left.children[1], right.children[1])));
+					}
+				}
+			}
+			ClassId u, v;
+			if (findSquare(graph, leftNodes, FunctionKind::Sine, u) && findSquare(graph, rightNodes, FunctionKind::Cosine, v) && u == v) {
+				// sin(u) ^ 2 + cos(u) ^ 2 = 1
+				graph.merge(id, graph.addConstant(1.0f));
+			}
+			if (findSquare(graph, leftNodes, FunctionKind::Cosine, u)) {
+				for (auto right : rightNodes) {
+					// cos(u) ^ 2 + (-1 * sin(u) ^ 2) = cos(2 * u)
+					if (right.op == Op::Product && graph.isConstant(right.children[0], -1.0f) &&
+						findSquare(graph, graph.nodes(right.children[1]), FunctionKind::Sine, v) && u == v) {
+						graph.merge(id, graph.addFunction(FunctionKind::Cosine, graph.add(Op::Product, graph.addConstant(2.0f), u)));
+					}
+				}
+			}
+			for (auto left : leftNodes) {
+				if (!isKind(left, FunctionKind::NaturalLogarithm) || !isPositive(graph, left.children[0])) {
+					continue;
+				}
+				// ln(p) + ln(q) = ln(p * q), only for positive p and q
+				for (auto right : rightNodes) {
+					if (full()) return;
+					if (isKind(right, FunctionKind::NaturalLogarithm) && isPositive(graph, right.children[0])) {
+						graph.merge(id, graph.addFunction(FunctionKind::NaturalLogarithm, graph.add(Op::Product, left.children[0], right.children[0])));
+					}
+				}
+			}
+			break;
+		}
+		case Op::Product: {
+			// a * b = b * a
+			graph.merge(id, graph.add(Op::Product, b, a));
+			// 0 * b = 0
+			if (graph.isConstant(a, 0.0f)) {
+				graph.merge(id, a);
+			}
+			// 1 * b = b
+			if (graph.isConstant(a, 1.0f)) {
+				graph.merge(id, b);
+			}
+			// a * a = a ^ 2
+			if (graph.find(a) == graph.find(b)) {
+				graph.merge(id, graph.add(Op::Power, a, graph.addConstant(2.0f)));
+			}
+			// (p * q) * b = p * (q * b)
+			for (auto left : leftNodes) {
+				if (left.op == Op::Product) {
+					graph.merge(id, graph.add(Op::Product, left.children[0], graph.add(Op::Product, left.children[1], b)));
+				}
+			}
+			// n * (p + q) = n * p + n * q, only for constants to limit growth
+			float constant;
+			if (graph.constantOf(a, constant)) {
+				for (auto right : rightNodes) {
+					if (right.op == Op::Sum) {
+						graph.merge(id, graph.add(Op::Sum, graph.add(Op::Product, a, right.children[0]), graph.add(Op::Product, a, right.children[1])));
+					}
+				}
+			}
+			for (auto right : rightNodes) {
+				if (right.op != Op::Power) {
+					continue;
+				}
+				// a * (a ^ n) = a ^ (n + 1)
+				if (graph.find(right.children[0]) == graph.find(a)) {
+					graph.merge(id, graph.add(Op::Power, a, graph.add(Op::Sum, right.children[1], graph.addConstant(1.0f))));
+				}
+				// (p ^ n) * (p ^ m) = p ^ (n + m)
+				for (auto left : leftNodes) {
+					if (full()) return;
+					if (left.op == Op::Power && graph.find(left.children[0]) == graph.find(right.children[0])) {
+						graph.merge(id, graph.add(Op::Power, left.children[0], graph.add(Op::Sum, left.children[1], right.children[1])));
+					}
+				}
+			}
+			for (auto left : leftNodes) {
+				if (!isKind(left, FunctionKind::Sine)) {
+					continue;
+				}
+				// sin(u) * cos(u) = 0.5 * sin(2 * u)
+				for (auto right : rightNodes) {
+					if (full()) return;
+					if (isKind(right, FunctionKind::Cosine) && graph.find(left.children[0]) == graph.find(right.children[0])) {
+						graph.merge(id, graph.add(Op::Product, graph.addConstant(0.5f),
+							graph.addFunction(FunctionKind::Sine, graph.add(Op::Product, graph.addConstant(2.0f), left.children[0]))));
+					}
+				}
+			}
+			break;
+		}
+		case Op::Power: {
+			float exponent;
+			if (graph.constantOf(b, exponent)) {
+				// a ^ 0 = 1
+				if (exponent == 0.0f) {
+					graph.merge(id, graph.addConstant(1.0f));
+				}
+				// a ^ 1 = a
+				else if (exponent == 1.0f) {
+					graph.merge(id, a);
+				}
+				// a ^ n = a * a ^ (n - 1), trading a powf call for multiplications
+				else if (isSmallInteger(exponent)) {
+					graph.merge(id, graph.add(Op::Product, a, graph.add(Op::Power, a, graph.addConstant(exponent - 1.0f))));
+				}
+			}
+			for (auto base : leftNodes) {
+				if (base.op != Op::Power) {
+					continue;
+				}
+				ClassId p = base.children[0];
+				ClassId n = base.children[1];
+				float inner, outer;
+				bool constant = graph.constantOf(n, inner);
+				// (p ^ n) ^ m = p ^ (n * m), only where both sides agree for negative p
+				if (isPositive(graph, p) || (constant && isInteger(inner) && graph.constantOf(b, outer) && isInteger(outer))) {
+					graph.merge(id, graph.add(Op::Power, p, graph.add(Op::Product, n, b)));
+				}
+				// (p ^ 2k) ^ m = abs(p) ^ (2k * m)
+				else if (constant && isInteger(inner) && fmodf(inner, 2.0f) == 0.0f) {
+					graph.merge(id, graph.add(Op::Power, graph.addFunction(FunctionKind::AbsoluteValue, p), graph.add(Op::Product, n, b)));
+				}
+			}
+			break;
+		}
+		case Op::Function: {
+			if (!isKind(node, FunctionKind::NaturalLogarithm)) {
+				break;
+			}
+			for (auto argument : leftNodes) {
+				if (argument.op != Op::Power) {
+					continue;
+				}
+				ClassId p = argument.children[0];
+				ClassId q = argument.children[1];
+				float exponent;
+				bool constant = graph.constantOf(q, exponent) && exponent != 0.0f;
+				// ln(p ^ q) = q * ln(p), only where both sides agree for negative p
+				if (isPositive(graph, p) || (constant && fmodf(exponent, 2.0f) != 0.0f)) {
+					graph.merge(id, graph.add(Op::Product, q, graph.addFunction(FunctionKind::NaturalLogarithm, p)));
+				}
+				// ln(p ^ 2n) = 2n * ln(abs(p))
+				else if (constant) {
+					ClassId absolute = graph.addFunction(FunctionKind::AbsoluteValue, p);
+					graph.merge(id, graph.add(Op::Product, q, graph.addFunction(FunctionKind::NaturalLogarithm, absolute)));
+				}
+			}
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+class Saturation {
+public:
+	// The time budget counts from start, shared by the elements of a vector
+	Saturation(const SaturationLimits &limits, std::chrono::steady_clock::time_point start) :
+	fLimits(limits),
+	fStart(start) {}
+
+	std::shared_ptr<Node> run(const std::shared_ptr<Node> &node) {
+		if (isVector(node)) {
+			auto vector = toVector(node);
+			std::vector<std::shared_ptr<Node>> s;
+			s.reserve(vector->getDimension());
+			for (auto &element : vector->elements) {
+				// Elements left once the time is up are kept as they are
+				s.push_back(withinTime() ? Saturation(fLimits, fStart).run(element) : element);
+			}
+			return newVector(std::move(s));
+		}
+		ClassId root = insert(node);
+		saturate();
+		return extract(root);
+	}
+
+private:
+	// Inserts the tree below root, children first
+	ClassId insert(const std::shared_ptr<Node> &root) {
+		std::vector<std::pair<const std::shared_ptr<Node>*, size_t>> frames{{&root, 0}};
+		std::vector<ClassId> results;
+		while (!frames.empty()) {
+			auto &frame = frames.back();
+			auto &node = *frame.first;
+			// Nodes kept opaque are inserted without their children
+			size_t count = isSum(node) || isProduct(node) || isPower(node) || isFunction(node) ? node->getChildCount() : 0;
+			if (frame.second < count) {
+				frames.push_back({&node->getChild(frame.second++), 0});
+				continue;
+			}
+			frames.pop_back();
+			ClassId id = insertLocal(node, results.data() + results.size() - count);
+			results.resize(results.size() - count);
+			results.push_back(id);
+		}
+		return results.back();
+	}
+
+	ClassId insertLocal(const std::shared_ptr<Node> &node, const ClassId *children) {
+		if (isConstant(node)) {
+			return fGraph.addConstant(toConstant(node)->fValue);
+		}
+		if (isVariable(node)) {
+			return fGraph.add(ENode{Op::Variable});
+		}
+		if (isSum(node)) {
+			return fGraph.add(Op::Sum, children[0], children[1]);
+		}
+		if (isProduct(node)) {
+			return fGraph.add(Op::Product, children[0], children[1]);
+		}
+		if (isPower(node)) {
+			return fGraph.add(Op::Power, children[0], children[1]);
+		}
+		if (isFunction(node)) {
+			return fGraph.addFunction(toFunction(node)->fKind, children[0]);
+		}
+		// Every use of a shared leaf, a parameter for example, is the same class
+		auto found = fOpaqueIndices.emplace(node.get(), static_cast<uint32_t>(fOpaque.size()));
+		if (found.second) {
+			fOpaque.push_back(node);
+		}
+		ENode opaque{Op::Opaque};
+		opaque.index = found.first->second;
+		return fGraph.add(opaque);
+	}
+
+	bool withinTime() const {
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - fStart;
+		return elapsed.count() < fLimits.maxMilliseconds;
+	}
+
+	bool withinLimits() const {
+		return fGraph.nodeCount() < fLimits.maxNodes && withinTime();
+	}
+
+	void saturate() {
+		for (size_t iteration = 0; iteration < fLimits.maxIterations && withinLimits(); iteration++) {
+			fGraph.fChanged = false;
+			// Rules only see the nodes present at the start of the iteration
+			std::vector<std::pair<ClassId, ENode>> snapshot;
+			for (ClassId id = 0; id < fGraph.classCount(); id++) {
+				if (fGraph.find(id) != id) {
+					continue;
+				}
+				for (auto &node : fGraph.nodes(id)) {
+					snapshot.emplace_back(id, node);
+				}
+			}
+			// A single iteration on a large graph may take longer than the whole budget
+			for (auto &entry : snapshot) {
+				applyRules(fGraph, entry.first, entry.second, fLimits.maxNodes);
+				if (!withinLimits()) {
+					break;
+				}
+			}
+			fGraph.rebuild();
+			if (!fGraph.fChanged) {
+				break;
+			}
+		}
+	}
+
+	float nodeCost(const ENode &node) {
+		switch (node.op) {
+			case Op::Constant:
+			case Op::Variable:
+				return 0.0f;
+			case Op::Opaque:
+				return evaluationCost(NodeRef(fOpaque[node.index])).total();
+			case Op::Sum:
+			case Op::Product:
+				return 1.0f;
+			default:
+				return kCallCost;
+		}
+	}
+
+	std::shared_ptr<Node> extract(ClassId root) {
+		// Costs only decrease, so iterate until nothing improves
+		const float infinity = std::numeric_limits<float>::infinity();
+		fCosts.assign(fGraph.classCount(), {infinity, 0});
+		fBest.assign(fGraph.classCount(), ENode{Op::Constant});
+		bool improved = true;
+		while (improved) {
+			improved = false;
+			for (ClassId id = 0; id < fGraph.classCount(); id++) {
+				if (fGraph.find(id) != id) {
+					continue;
+				}
+				for (auto &node : fGraph.nodes(id)) {
+					std::pair<float, size_t> cost{nodeCost(node), 1};
+					for (size_t i = 0; i < node.arity(); i++) {
+						auto &child = fCosts[fGraph.find(node.children[i])];
+						cost.first += child.first;
+						cost.second += child.second;
+					}
+					// Prefer smaller trees when the evaluation cost is equal
+					if (cost < fCosts[id]) {
+						fCosts[id] = cost;
+						fBest[id] = node;
+						improved = true;
+					}
+				}
+			}
+		}
+		fExtracted.assign(fGraph.classCount(), nullptr);
+		return build(fGraph.find(root));
+	}
+
+	// Builds the best node of every class below root, children first
+	std::shared_ptr<Node> build(ClassId root) {
+		std::vector<std::pair<ClassId, size_t>> frames{{root, 0}};
+		while (!frames.empty()) {
+			auto &frame = frames.back();
+			ClassId id = frame.first;
+			auto &node = fBest[id];
+			if (frame.second < node.arity()) {
+				ClassId child = fGraph.find(node.children[frame.second++]);
+				if (!fExtracted[child]) {
+					frames.push_back({child, 0});
+				}
+				continue;
+			}
+			frames.pop_back();
+			if (!fExtracted[id]) {
+				fExtracted[id] = buildLocal(node);
+			}
+		}
+		return fExtracted[root];
+	}
+
+	std::shared_ptr<Node> buildLocal(const ENode &node) {
+		auto child = [this, &node](size_t index) { return fExtracted[fGraph.find(node.children[index])]; };
+		switch (node.op) {
+			case Op::Constant:
+				return newConstant(node.value);
+			case Op::Variable:
+				return newVariable();
+			case Op::Opaque:
+				return fOpaque[node.index];
+			case Op::Sum:
+				return newSum(child(0), child(1));
+			case Op::Product:
+				return newProduct(child(0), child(1));
+			case Op::Power:
+				return newPower(child(0), child(1));
+			case Op::Function:
+				return newFunction(static_cast<FunctionKind>(node.index), child(0));
+		}
+		return nullptr;
+	}
+
+	SaturationLimits fLimits;
+	std::chrono::steady_clock::time_point fStart;
+	EGraph fGraph;
+	std::vector<std::shared_ptr<Node>> fOpaque;
+	std::unordered_map<const Node*, uint32_t> fOpaqueIndices;	// Into fOpaque
+	std::vector<std::pair<float, size_t>> fCosts;
+	std::vector<ENode> fBest;
+	std::vector<std::shared_ptr<Node>> fExtracted;
+};
+
+}
+
+NodeRef NodeRef::saturate(const SaturationLimits &limits) {
+	SYMBOLIC_TRACE("saturate");
+	return NodeRef(Saturation(limits, std::chrono::steady_clock::now()).run(fRef));
+}
+
+EvaluationCost evaluationCost(const NodeRef &node) {
+	EvaluationCost cost;
+	// Nodes with the number of evaluations they cost, more than one inside an integral
+	std::vector<std::pair<const std::shared_ptr<Node>*, size_t>> pending{{&node.fRef, 1}};
+	while (!pending.empty()) {
+		auto current = pending.back();
+		pending.pop_back();
+		auto &n = *current.first;
+		size_t evaluations = current.second;
+		if (isSum(n) || isProduct(n)) {
+			cost.flops += evaluations;
+		}
+		else if (isPower(n) || isFunction(n)) {
+			cost.calls += evaluations;
+		}
+		else if (isIntegral(n)) {
+			// At least one 15 point quadrature panel
+			cost.flops += 30 * evaluations;
+			evaluations *= 15;
+		}
+		for (size_t i = 0; i < n->getChildCount(); i++) {
+			pending.push_back({&n->getChild(i), evaluations});
+		}
+	}
+	return cost;
+}
@@ -0,0 +1,131 @@
+#include "symbolic.h"
+#include "symbolic_internal.h"
+#include <algorithm>
+#include <unordered_map>
+
+/*
+	Incremental evaluation
+
+	The expression is flattened into entries in post-order, shared
+	subexpressions becoming a single entry. Changing a parameter or x marks
+	the entries above it dirty, which are then recomputed in post-order so
+	every argument is up to date before it is used.
+*/
+
+IncrementalEvaluator::IncrementalEvaluator(const NodeRef &node) :
+fRoot(node) {
+	if (isVector(node.fRef)) {
+		throw std::invalid_argument("IncrementalEvaluator of a vector, see ComponentEvaluator");
+	}
+	std::unordered_map<Node*, size_t> indices;
+	std::vector<std::pair<Node*, size_t>> frames{{node.fRef.get(), 0}};
+	size_t maxArguments = 0;
+	while (!frames.empty()) {
+		auto &frame = frames.back();
+		auto current = frame.first;
+		size_t count = current->getChildCount();
+		if (frame.second < count) {
+			auto child = current->getChild(frame.second++).get();
+			if (!indices.count(child)) {
+				frames.push_back({child, 0});
+			}
+			continue;
+		}
+		frames.pop_back();
+		if (indices.count(current)) {
+			continue;
+		}
+		size_t index = fEntries.size();
+		fEntries.push_back({current, fArguments.size(), 0, 0, true});
+		for (size_t i = 0; i < count; i++) {
+			fArguments.push_back(indices[current->getChild(i).get()]);
+		}
+		maxArguments = std::max(maxArguments, count);
+		indices[current] = index;
+
+		if (auto parameter = dynamic_cast<Parameter*>(current)) {
+			fParameters.push_back(index);
+			fParameterValues.push_back(parameter->fValue);
+		}
+		// Integrals evaluate their integrand themselves, from 0 to x
+		else if (dynamic_cast<Variable*>(current) || dynamic_cast<Integral*>(current)) {
+			fSources.push_back(index);
+		}
+	}
+
+	// Parents of every entry, grouped per entry
+	std::vector<size_t> counts(fEntries.size(), 0);
+	for (auto argument : fArguments) {
+		counts[argument]++;
+	}
+	size_t first = 0;
+	for (size_t i = 0; i < fEntries.size(); i++) {
+		fEntries[i].firstParent = first;
+		first += counts[i];
+	}
+	fParents.resize(first);
+	for (size_t i = 0; i < fEntries.size(); i++) {
+		auto &entry = fEntries[i];
+		for (size_t j = 0; j < entry.node->getChildCount(); j++) {
+			auto &child = fEntries[fArguments[entry.firstArgument + j]];
+			fParents[child.firstParent + child.parentCount++] = i;
+		}
+	}
+
+	fValues.resize(fEntries.size());
+	fScratch.resize(maxArguments);
+}
+
+void IncrementalEvaluator::markDirty(size_t index) {
+	std::vector<size_t> pending{index};
+	while (!pending.empty()) {
+		auto &entry = fEntries[pending.back()];
+		size_t current = pending.back();
+		pending.pop_back();
+		if (entry.dirty) {
+			continue;
+		}
+		entry.dirty = true;
+		fDirty.push_back(current);
+		pending.insert(pending.end(), fParents.begin() + entry.firstParent, fParents.begin() + entry.firstParent + entry.parentCount);
+	}
+}
+
+float IncrementalEvaluator::evaluate(float x) {
+	fDirty.clear();
+	if (!fEvaluated) {
+		// Everything starts out dirty
+		for (size_t i = 0; i < fEntries.size(); i++) {
+			fDirty.push_back(i);
+		}
+		fEvaluated = true;
+	}
+	else {
+		if (x != fX) {
+			for (auto source : fSources) {
+				markDirty(source);
+			}
+		}
+		for (size_t i = 0; i < fParameters.size(); i++) {
+			float value = static_cast<Parameter*>(fEntries[fParameters[i]].node)->fValue;
+			if (value != fParameterValues[i]) {
+				fParameterValues[i] = value;
+				markDirty(fParameters[i]);
+			}
+		}
+		std::sort(fDirty.begin(), fDirty.end());
+	}
+	fX = x;
+
+	for (auto index : fDirty) {
+		auto &entry = fEntries[index];
+		size_t count = entry.node->getChildCount();
+		for (size_t i = 0; i < count; i++) {
+			fScratch[i] = fValues[fArguments[entry.firstArgument + i]];
+		}
+		fValues[index] = entry.node->evaluateLocal(x, fScratch.data());
+		entry.dirty = false;
+	}
+	fRecomputed = fDirty.size();
+	return fValues.back();
+}
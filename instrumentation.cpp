@@ -0,0 +1,101 @@
+#include "instrumentation.h"
+#include "symbolic.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+struct TraceEvent {
+	const char *name;
+	double start;		// Microseconds
+	double duration;	// Negative for tree size counters
+	size_t size;
+	size_t depth;
+};
+
+thread_local Statistics gStatistics;
+thread_local std::vector<TraceEvent> gEvents;
+
+#ifdef SYMBOLIC_INSTRUMENTATION
+
+double now() {
+	static const auto start = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif
+
+void writeString(std::ostream &stream, const char *text) {
+	stream << '"';
+	for (; *text; text++) {
+		if (*text == '"' || *text == '\\') {
+			stream << '\\';
+		}
+		stream << *text;
+	}
+	stream << '"';
+}
+
+}
+
+Statistics statistics() {
+	return gStatistics;
+}
+
+void resetStatistics() {
+	gStatistics = Statistics();
+	gEvents.clear();
+}
+
+void writeChromeTrace(std::ostream &stream) {
+	stream << "{\"traceEvents\":[";
+	bool first = true;
+	for (auto &event : gEvents) {
+		if (!first) { stream << ","; } else { first = false; }
+		stream << "{\"name\":";
+		writeString(stream, event.name);
+		if (event.duration >= 0.0) {
+			stream << ",\"ph\":\"X\",\"ts\":" << event.start << ",\"dur\":" << event.duration;
+		}
+		else {
+			stream << ",\"ph\":\"C\",\"ts\":" << event.start << ",\"args\":{\"size\":" << event.size << ",\"depth\":" << event.depth << "}";
+		}
+		stream << ",\"pid\":1,\"tid\":1}";
+	}
+	stream << "]}";
+}
+
+#ifdef SYMBOLIC_INSTRUMENTATION
+
+void countAllocation(const char *nodeClass) {
+	gStatistics.allocations[nodeClass]++;
+}
+
+void countRule(const char *rule) {
+	gStatistics.rules[rule]++;
+}
+
+void recordPass(const std::shared_ptr<Node> &before, const std::shared_ptr<Node> &after) {
+	Statistics::Pass pass{before->size(), before->depth(), after->size(), after->depth()};
+	gStatistics.simplifyPasses++;
+	gStatistics.passes.push_back(pass);
+	gEvents.push_back({"tree", now(), -1.0, pass.sizeAfter, pass.depthAfter});
+}
+
+EqualsScope::EqualsScope() {
+	gStatistics.equalsCalls++;
+}
+
+EqualsScope::~EqualsScope() {
+	gStatistics.equalsMaxPending = std::max(gStatistics.equalsMaxPending, fMaxPending);
+}
+
+TraceScope::TraceScope(const char *name) :
+fName(name),
+fStart(now()) {}
+
+TraceScope::~TraceScope() {
+	gEvents.push_back({fName, fStart, now() - fStart, 0, 0});
+}
+
+#endif
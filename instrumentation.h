@@ -0,0 +1,84 @@
+#pragma once
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+	Opt-in instrumentation, enabled by defining SYMBOLIC_INSTRUMENTATION
+	(the SYMBOLIC_INSTRUMENTATION CMake option). When disabled the macros
+	below expand to nothing and statistics() stays empty.
+
+	Statistics are kept per thread, statistics() returns those of the
+	calling thread.
+*/
+
+struct Statistics {
+	// Size and depth of the tree around one NodeRef::simplify() pass
+	struct Pass {
+		size_t sizeBefore;
+		size_t depthBefore;
+		size_t sizeAfter;
+		size_t depthAfter;
+	};
+
+	std::map<std::string, size_t> allocations;	// Nodes allocated per class
+	std::map<std::string, size_t> rules;		// Firings per simplification rule
+	size_t simplifyPasses{0};
+	size_t equalsCalls{0};
+	size_t equalsMaxPending{0};	// Most node pairs waiting to be compared by one equals()
+	std::vector<Pass> passes;
+};
+
+Statistics statistics();
+void resetStatistics();
+// Writes the recorded spans and tree sizes in the Chrome trace event format
+void writeChromeTrace(std::ostream &stream);
+
+#ifdef SYMBOLIC_INSTRUMENTATION
+
+class Node;
+
+void countAllocation(const char *nodeClass);
+void countRule(const char *rule);
+void recordPass(const std::shared_ptr<Node> &before, const std::shared_ptr<Node> &after);
+
+class EqualsScope {
+public:
+	EqualsScope();
+	~EqualsScope();
+
+	void pending(size_t count) { fMaxPending = count > fMaxPending ? count : fMaxPending; }
+
+private:
+	size_t fMaxPending{0};
+};
+
+class TraceScope {
+public:
+	TraceScope(const char *name);
+	~TraceScope();
+
+private:
+	const char *fName;
+	double fStart;
+};
+
+#define SYMBOLIC_COUNT_ALLOCATION(nodeClass) countAllocation(nodeClass)
+#define SYMBOLIC_COUNT_RULE(rule) countRule(rule)
+#define SYMBOLIC_RECORD_PASS(before, after) recordPass(before, after)
+#define SYMBOLIC_TRACE_EQUALS() EqualsScope equalsScope
+#define SYMBOLIC_EQUALS_PENDING(count) equalsScope.pending(count)
+#define SYMBOLIC_TRACE(name) TraceScope traceScope(name)
+
+#else
+
+#define SYMBOLIC_COUNT_ALLOCATION(nodeClass) ((void)0)
+#define SYMBOLIC_COUNT_RULE(rule) ((void)0)
+#define SYMBOLIC_RECORD_PASS(before, after) ((void)0)
+#define SYMBOLIC_TRACE_EQUALS() ((void)0)
+#define SYMBOLIC_EQUALS_PENDING(count) ((void)0)
+#define SYMBOLIC_TRACE(name) ((void)0)
+
+#endif
@@ -0,0 +1,147 @@
+#include "symbolic.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+/*
+	Adaptive Gauss-Kronrod quadrature
+
+	Each panel is integrated with the 15 point Kronrod rule, the embedded 7
+	point Gauss rule gives the error estimate. Panels whose error exceeds their
+	share of the tolerance are bisected. Pending panels are evaluated together
+	so a single batch evaluation covers several panels at once.
+*/
+
+namespace {
+
+// Abscissae of the 15 point Kronrod rule, the odd ones are the 7 point Gauss abscissae
+const double kKronrodNodes[8] = {
+	0.991455371120812639206854697526329,
+	0.949107912342758524526189684047851,
+	0.864864423359769072789712788640926,
+	0.741531185599394439863864773280788,
+	0.586087235467691130294144845693013,
+	0.405845151377397166906606412076961,
+	0.207784955007898467600689403773245,
+	0.000000000000000000000000000000000
+};
+
+const double kKronrodWeights[8] = {
+	0.022935322010529224963732008058970,
+	0.063092092629978553290700663189204,
+	0.104790010322250183839876322541518,
+	0.140653259715525918745189590510238,
+	0.169004726639267902826583426598550,
+	0.190350578064785409913256402421014,
+	0.204432940075298892414161999234649,
+	0.209482141084727828012999174891714
+};
+
+const double kGaussWeights[4] = {
+	0.129484966168869693270611432679082,
+	0.279705391489276667901467771423780,
+	0.381830050505118944950369775488975,
+	0.417959183673469387755102040816327
+};
+
+constexpr size_t kPointsPerPanel = 15;
+constexpr size_t kPanelsPerBatch = kBatchSize / kPointsPerPanel;
+// Bounds the work spent on integrands that do not converge, such as singularities
+constexpr size_t kMaxPanels = 1 << 14;
+
+struct Panel {
+	double a;
+	double b;
+};
+
+// Writes the 15 abscissae of a panel, the center last
+void panelPoints(const Panel &panel, float *x) {
+	double center = 0.5 * (panel.a + panel.b);
+	double half = 0.5 * (panel.b - panel.a);
+	for (size_t j = 0; j < 7; j++) {
+		x[2 * j] = static_cast<float>(center - half * kKronrodNodes[j]);
+		x[2 * j + 1] = static_cast<float>(center + half * kKronrodNodes[j]);
+	}
+	x[14] = static_cast<float>(center);
+}
+
+// Returns the Kronrod estimate and stores the difference with the Gauss estimate in error
+double panelIntegral(const Panel &panel, const float *f, double &error) {
+	double half = 0.5 * (panel.b - panel.a);
+	double kronrod = kKronrodWeights[7] * f[14];
+	double gauss = kGaussWeights[3] * f[14];
+	for (size_t j = 0; j < 7; j++) {
+		double pair = static_cast<double>(f[2 * j]) + f[2 * j + 1];
+		kronrod += kKronrodWeights[j] * pair;
+		if (j % 2 == 1) {
+			gauss += kGaussWeights[j / 2] * pair;
+		}
+	}
+	error = std::abs((kronrod - gauss) * half);
+	return kronrod * half;
+}
+
+}
+
+float integrate(const NodeRef &node, float a, float b, float tolerance) {
+	NodeRef integrand = node;
+	double total = 0.0;
+	double width = std::abs(static_cast<double>(b) - a);
+	if (width == 0.0) {
+		return 0.0f;
+	}
+	std::vector<Panel> pending{{a, b}};
+	size_t panels = 1;
+	float x[kBatchSize];
+	float f[kBatchSize];
+	while (!pending.empty()) {
+		Panel batch[kPanelsPerBatch];
+		size_t count = std::min(pending.size(), kPanelsPerBatch);
+		for (size_t p = 0; p < count; p++) {
+			batch[p] = pending.back();
+			pending.pop_back();
+			panelPoints(batch[p], x + p * kPointsPerPanel);
+		}
+		integrand.evaluate(x, f, count * kPointsPerPanel);
+		for (size_t p = 0; p < count; p++) {
+			auto &panel = batch[p];
+			double error;
+			double value = panelIntegral(panel, f + p * kPointsPerPanel, error);
+			double share = tolerance * std::abs(panel.b - panel.a) / width;
+			double center = 0.5 * (panel.a + panel.b);
+			// Accept when accurate enough, or when float can no longer split the panel
+			bool unsplittable = static_cast<float>(center) == static_cast<float>(panel.a) ||
+				static_cast<float>(center) == static_cast<float>(panel.b);
+			if (error <= share || unsplittable || panels >= kMaxPanels || !std::isfinite(value)) {
+				total += value;
+			}
+			else {
+				pending.push_back({panel.a, center});
+				pending.push_back({center, panel.b});
+				panels++;
+			}
+		}
+	}
+	return static_cast<float>(total);
+}
+
+std::vector<float> integrate(const NodeRef &node, const std::vector<std::pair<float, float>> &intervals, float tolerance) {
+	std::vector<float> results(intervals.size());
+	std::atomic<size_t> next{0};
+	auto worker = [&]() {
+		for (size_t i = next++; i < intervals.size(); i = next++) {
+			results[i] = integrate(node, intervals[i].first, intervals[i].second, tolerance);
+		}
+	};
+	size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), intervals.size());
+	std::vector<std::thread> pool;
+	for (size_t t = 1; t < threads; t++) {
+		pool.emplace_back(worker);
+	}
+	worker();
+	for (auto &thread : pool) {
+		thread.join();
+	}
+	return results;
+}
@@ -0,0 +1,366 @@
+#include "symbolic.h"
+#include "symbolic_internal.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+/*
+	Interval arithmetic
+
+	Bounds are computed in double and rounded outwards to float, widening by
+	one float ulp on each side so the result also contains what the float
+	math library returns for any x in the input interval. Where an expression
+	is undefined (ln of a negative number) the interval is empty, both bounds
+	being NaN, so it can never contain a root or an extremum.
+*/
+
+namespace {
+
+const float kInfinity = std::numeric_limits<float>::infinity();
+const float kNaN = std::numeric_limits<float>::quiet_NaN();
+const Interval kWhole{-kInfinity, kInfinity};
+const Interval kEmpty{kNaN, kNaN};
+
+Interval outward(double lower, double upper) {
+	if (std::isnan(lower) || std::isnan(upper)) {
+		return kEmpty;
+	}
+	return {std::nextafter(static_cast<float>(lower), -kInfinity), std::nextafter(static_cast<float>(upper), kInfinity)};
+}
+
+bool isEmpty(const Interval &x) {
+	return std::isnan(x.lower);
+}
+
+bool isWhole(const Interval &x) {
+	return x.lower == -kInfinity && x.upper == kInfinity;
+}
+
+bool isInteger(float value) {
+	return std::isfinite(value) && value == std::floor(value);
+}
+
+// Monotonic functions map the endpoints
+template <typename F>
+Interval increasing(const Interval &x, F f) {
+	return outward(f(static_cast<double>(x.lower)), f(static_cast<double>(x.upper)));
+}
+
+Interval multiply(const Interval &a, const Interval &b) {
+	if (isEmpty(a) || isEmpty(b)) {
+		return kEmpty;
+	}
+	double products[4] = {
+		static_cast<double>(a.lower) * b.lower,
+		static_cast<double>(a.lower) * b.upper,
+		static_cast<double>(a.upper) * b.lower,
+		static_cast<double>(a.upper) * b.upper
+	};
+	for (auto product : products) {
+		// 0 * inf
+		if (std::isnan(product)) {
+			return kWhole;
+		}
+	}
+	return outward(*std::min_element(products, products + 4), *std::max_element(products, products + 4));
+}
+
+// Base raised to a constant exponent
+Interval power(const Interval &base, float exponent) {
+	// Even where the base is undefined, as powf(NaN, 0) is 1
+	if (exponent == 0.0f) {
+		return {1.0f, 1.0f};
+	}
+	if (isEmpty(base)) {
+		return kEmpty;
+	}
+	auto pow = [exponent](double v) { return std::pow(v, static_cast<double>(exponent)); };
+	if (isInteger(exponent)) {
+		bool even = std::fmod(exponent, 2.0f) == 0.0f;
+		if (base.contains(0.0f)) {
+			if (exponent < 0.0f) {
+				// Pole at zero
+				return even ? Interval{0.0f, kInfinity} : kWhole;
+			}
+			if (even) {
+				return outward(0.0, pow(std::max(-static_cast<double>(base.lower), static_cast<double>(base.upper))));
+			}
+			return increasing(base, pow);
+		}
+		// Monotonic on either side of zero
+		double a = pow(base.lower);
+		double b = pow(base.upper);
+		return outward(std::min(a, b), std::max(a, b));
+	}
+	// Only defined for non negative bases
+	if (base.upper < 0.0f) {
+		return kEmpty;
+	}
+	double a = pow(std::max(0.0, static_cast<double>(base.lower)));
+	double b = pow(base.upper);
+	return outward(std::min(a, b), std::max(a, b));
+}
+
+/*
+	Periodic functions, the extremes are reached when a maximum or minimum
+	of the function lies inside the interval
+*/
+bool containsPeriodic(const Interval &x, double offset) {
+	double period = 2.0 * M_PI;
+	double k = std::ceil((x.lower - offset) / period);
+	return offset + k * period <= x.upper;
+}
+
+}
+
+// Functions
+Interval logarithm(const Interval &x) {
+	if (isEmpty(x) || x.upper <= 0.0f) {
+		return kEmpty;
+	}
+	double lower = x.lower <= 0.0f ? -std::numeric_limits<double>::infinity() : std::log(static_cast<double>(x.lower));
+	return outward(lower, std::log(static_cast<double>(x.upper)));
+}
+
+Interval exponential(const Interval &x) {
+	return increasing(x, [](double v) { return std::exp(v); });
+}
+
+Interval sine(const Interval &x) {
+	if (isEmpty(x)) {
+		return kEmpty;
+	}
+	if (!std::isfinite(x.lower) || !std::isfinite(x.upper) || x.width() >= 2.0 * M_PI) {
+		return {-1.0f, 1.0f};
+	}
+	double a = std::sin(static_cast<double>(x.lower));
+	double b = std::sin(static_cast<double>(x.upper));
+	double lower = containsPeriodic(x, -0.5 * M_PI) ? -1.0 : std::min(a, b);
+	double upper = containsPeriodic(x, 0.5 * M_PI) ? 1.0 : std::max(a, b);
+	auto result = outward(lower, upper);
+	return {std::max(result.lower, -1.0f), std::min(result.upper, 1.0f)};
+}
+
+Interval cosine(const Interval &x) {
+	if (isEmpty(x)) {
+		return kEmpty;
+	}
+	if (!std::isfinite(x.lower) || !std::isfinite(x.upper) || x.width() >= 2.0 * M_PI) {
+		return {-1.0f, 1.0f};
+	}
+	double a = std::cos(static_cast<double>(x.lower));
+	double b = std::cos(static_cast<double>(x.upper));
+	double lower = containsPeriodic(x, M_PI) ? -1.0 : std::min(a, b);
+	double upper = containsPeriodic(x, 0.0) ? 1.0 : std::max(a, b);
+	auto result = outward(lower, upper);
+	return {std::max(result.lower, -1.0f), std::min(result.upper, 1.0f)};
+}
+
+// Increasing between the poles at pi / 2 + k * pi
+Interval tangent(const Interval &x) {
+	if (isEmpty(x)) {
+		return kEmpty;
+	}
+	if (!std::isfinite(x.lower) || !std::isfinite(x.upper) || x.width() >= M_PI) {
+		return kWhole;
+	}
+	double k = std::ceil((x.lower - 0.5 * M_PI) / M_PI);
+	if (0.5 * M_PI + k * M_PI <= x.upper) {
+		return kWhole;
+	}
+	return increasing(x, [](double v) { return std::tan(v); });
+}
+
+Interval absolute(const Interval &x) {
+	if (isEmpty(x) || x.lower >= 0.0f) {
+		return x;
+	}
+	if (x.upper <= 0.0f) {
+		return {-x.upper, -x.lower};
+	}
+	return {0.0f, std::max(-x.lower, x.upper)};
+}
+
+Interval hyperbolicTangent(const Interval &x) {
+	return increasing(x, [](double v) { return std::tanh(v); });
+}
+
+Interval sign(const Interval &x) {
+	if (isEmpty(x)) {
+		return kEmpty;
+	}
+	return {x.lower > 0.0f ? 1.0f : x.lower < 0.0f ? -1.0f : 0.0f,
+		x.upper > 0.0f ? 1.0f : x.upper < 0.0f ? -1.0f : 0.0f};
+}
+
+Interval Node::evaluateIntervalLocal(const Interval &x, const Interval *arguments) {
+	return kWhole;
+}
+
+// Constant
+Interval Constant::evaluateIntervalLocal(const Interval &x, const Interval *arguments) {
+	return {fValue, fValue};
+}
+
+// Variable
+Interval Variable::evaluateIntervalLocal(const Interval &x, const Interval *arguments) {
+	return x;
+}
+
+// Parameter
+Interval Parameter::evaluateIntervalLocal(const Interval &x, const Interval *arguments) {
+	return {fValue, fValue};
+}
+
+// Sum
+Interval Sum::evaluateIntervalLocal(const Interval &x, const Interval *arguments) {
+	auto left = arguments[0];
+	auto right = arguments[1];
+	if (isEmpty(left) || isEmpty(right)) {
+		return kEmpty;
+	}
+	auto sum = outward(static_cast<double>(left.lower) + right.lower, static_cast<double>(left.upper) + right.upper);
+	// -inf + inf
+	return isEmpty(sum) ? kWhole : sum;
+}
+
+// Product
+Interval Product::evaluateIntervalLocal(const Interval &x, const Interval *arguments) {
+	// Exact for squares, where multiply() would allow negative values. Compared once, not per evaluation.
+	uint8_t square = fSquare.load(std::memory_order_relaxed);
+	if (!square) {
+		square = fLeft->equals(fRight) ? 2 : 1;
+		fSquare.store(square, std::memory_order_relaxed);
+	}
+	if (square == 2) {
+		return power(arguments[0], 2.0f);
+	}
+	return multiply(arguments[0], arguments[1]);
+}
+
+// Power
+/*
+	For a non constant exponent b ^ e = exp(e * ln(b)) with b > 0
+*/
+Interval Power::evaluateIntervalLocal(const Interval &x, const Interval *arguments) {
+	auto base = arguments[0];
+	auto exponent = arguments[1];
+	// powf(b, 0) and powf(1, e) are 1 even for a NaN b or e
+	if ((exponent.lower == 0.0f && exponent.upper == 0.0f) || (base.lower == 1.0f && base.upper == 1.0f)) {
+		return {1.0f, 1.0f};
+	}
+	if (isEmpty(base) || isEmpty(exponent)) {
+		return kEmpty;
+	}
+	if (exponent.lower == exponent.upper) {
+		return power(base, exponent.lower);
+	}
+	if (base.lower <= 0.0f || isWhole(exponent)) {
+		return kWhole;
+	}
+	return exponential(multiply(exponent, logarithm(base)));
+}
+
+// Function
+Interval Function::evaluateIntervalLocal(const Interval &x, const Interval *arguments) {
+	return functionInfo(fKind).evaluateInterval(arguments[0]);
+}
+
+// Branch and bound
+/*
+	Subdomains whose bounds exclude zero cannot contain a root and are
+	dropped, the others are bisected until no wider than the tolerance.
+*/
+std::vector<Interval> findRoots(const NodeRef &node, const Interval &domain, float tolerance) {
+	auto &root = node.fRef;
+	std::vector<Interval> roots;
+	std::vector<Interval> pending{domain};
+	while (!pending.empty()) {
+		auto x = pending.back();
+		pending.pop_back();
+		if (!root->evaluateInterval(x).contains(0.0f)) {
+			continue;
+		}
+		float middle = x.middle();
+		if (x.width() <= tolerance || middle <= x.lower || middle >= x.upper) {
+			roots.push_back(x);
+			continue;
+		}
+		// Upper half first so the lower half is popped first and roots come out sorted
+		pending.push_back({middle, x.upper});
+		pending.push_back({x.lower, middle});
+	}
+	// Merge touching ranges, which bracket the same root
+	std::vector<Interval> merged;
+	for (auto &x : roots) {
+		if (!merged.empty() && merged.back().upper >= x.lower) {
+			merged.back().upper = std::max(merged.back().upper, x.upper);
+		}
+		else {
+			merged.push_back(x);
+		}
+	}
+	return merged;
+}
+
+/*
+	Subdomains are explored by increasing lower bound. Every evaluation at a
+	midpoint is an upper bound on the minimum, subdomains whose lower bound
+	exceeds it are dropped.
+*/
+Extremum findMinimum(const NodeRef &node, const Interval &domain, float tolerance) {
+	auto &root = node.fRef;
+	struct Box {
+		Interval x;
+		float lower;
+		bool operator<(const Box &other) const { return lower > other.lower; }
+	};
+	Extremum best{domain.middle(), kInfinity, kWhole};
+	for (float x : {domain.lower, domain.middle(), domain.upper}) {
+		float value = root->evaluate(x);
+		if (value < best.value) {
+			best.x = x;
+			best.value = value;
+		}
+	}
+	std::priority_queue<Box> pending;
+	pending.push({domain, root->evaluateInterval(domain).lower});
+	// Lowest bound of the subdomains too narrow to split
+	float floor = kInfinity;
+	while (!pending.empty()) {
+		auto box = pending.top();
+		// Nothing left can improve on the best value by more than the tolerance
+		if (box.lower >= best.value - tolerance) {
+			break;
+		}
+		pending.pop();
+		float middle = box.x.middle();
+		float value = root->evaluate(middle);
+		if (value < best.value) {
+			best.x = middle;
+			best.value = value;
+		}
+		if (box.x.width() <= tolerance || middle <= box.x.lower || middle >= box.x.upper) {
+			floor = std::min(floor, box.lower);
+			continue;
+		}
+		for (auto half : {Interval{box.x.lower, middle}, Interval{middle, box.x.upper}}) {
+			float lower = root->evaluateInterval(half).lower;
+			if (lower <= best.value) {
+				pending.push({half, lower});
+			}
+		}
+	}
+	float lower = std::min(floor, best.value);
+	if (!pending.empty()) {
+		lower = std::min(lower, pending.top().lower);
+	}
+	best.bound = {lower, best.value};
+	return best;
+}
+
+Extremum findMaximum(const NodeRef &node, const Interval &domain, float tolerance) {
+	auto minimum = findMinimum(NodeRef(newProduct(newConstant(-1.0f), node.fRef)), domain, tolerance);
+	return {minimum.x, -minimum.value, {-minimum.bound.upper, -minimum.bound.lower}};
+}
@@ -73,6 +73,120 @@ void vectorTests() {
 	std::cout << "simplify " << v.simplify() << "\n";
 }
 
+void saturationTests() {
+	auto x = variable();
+
+	auto n = (x ^ x).derive();
+	std::cout << "expression " << n << "\n";
+	std::cout << "simplify " << n.simplify() << " cost " << evaluationCost(n.simplify()).total() << "\n";
+	std::cout << "saturate " << n.saturate() << " cost " << evaluationCost(n.saturate()).total() << "\n";
+
+	std::cout << "<------>\n";
+
+	auto m = 2.0f * x - 2.0f * (x ^ 2);
+	std::cout << "expression " << m << "\n";
+	std::cout << "simplify " << m.simplify() << " cost " << evaluationCost(m.simplify()).total() << "\n";
+	std::cout << "saturate " << m.saturate() << " cost " << evaluationCost(m.saturate()).total() << "\n";
+
+	std::cout << "<------>\n";
+}
+
+void trigonometryTests() {
+	auto x = variable();
+
+	// Math library calls per evaluation of each derivative, before and after simplification
+	NodeRef expressions[] = {cos(x) ^ 2, sin(x) ^ 2, ln(x ^ 3), (sin(x) ^ 2) + (cos(x) ^ 2), sin(x) * cos(x), x ^ x};
+	size_t before = 0, after = 0;
+	for (auto &expression : expressions) {
+		auto derivative = expression.derive();
+		auto simplified = derivative.simplify();
+		std::cout << "derivative " << derivative << " calls " << evaluationCost(derivative).calls << "\n";
+		std::cout << "simplify " << simplified << " calls " << evaluationCost(simplified).calls << "\n";
+		before += evaluationCost(derivative).calls;
+		after += evaluationCost(simplified).calls;
+	}
+	std::cout << "transcendental calls " << before << " -> " << after << "\n";
+
+	std::cout << "<------>\n";
+}
+
+void integrationTests() {
+	auto x = variable();
+
+	auto n = sin(x);
+	std::cout << "integral " << n << " over [0, pi] " << integrate(n, 0.0f, M_PI) << "\n";
+
+	auto m = 3.0f * (x ^ 2) + 2.0f * x;
+	std::cout << "integral " << m << " over [0, 1] " << integrate(m, 0.0f, 1.0f) << "\n";
+
+	auto p = sqrt(x);
+	std::cout << "integral " << p << " over [0, 1] " << integrate(p, 0.0f, 1.0f) << "\n";
+
+	std::vector<std::pair<float, float>> intervals;
+	for (int i = 0; i < 4; i++) {
+		intervals.emplace_back(0.0f, i * M_PI / 2);
+	}
+	auto integrals = integrate(n, intervals);
+	for (size_t i = 0; i < intervals.size(); i++) {
+		std::cout << "integral " << n << " over [0, " << intervals[i].second << "] " << integrals[i] << "\n";
+	}
+
+	std::cout << "<------>\n";
+}
+
+void antiderivativeTests() {
+	auto x = variable();
+
+	NodeRef expressions[] = {3.0f * (x ^ 2) + 2.0f * x, cos(2.0f * x + constant(1.0f)), 1.0f / x, 2 ^ x, x * sin(x)};
+	for (auto &expression : expressions) {
+		auto integral = expression.integrate().simplify();
+		std::cout << "expression " << expression << "\n";
+		std::cout << "integral " << integral << (containsIntegral(integral) ? " (unevaluated)" : "") << "\n";
+		std::cout << "over [1, 2] " << integral.evaluate(2.0f) - integral.evaluate(1.0f) << " numeric " << integrate(expression, 1.0f, 2.0f) << "\n";
+	}
+
+	std::cout << "<------>\n";
+}
+
+void intervalTests() {
+	auto x = variable();
+
+	auto n = sin(x) * (x ^ 2) - constant(1.0f);
+	Interval domain{-10.0f, 10.0f};
+	auto range = n.evaluate(domain);
+	std::cout << "expression " << n << " over [" << domain.lower << ", " << domain.upper << "] in [" << range.lower << ", " << range.upper << "]\n";
+	for (auto &root : findRoots(n, domain)) {
+		std::cout << "root in [" << root.lower << ", " << root.upper << "] value " << n.evaluate(root.middle()) << "\n";
+	}
+	auto minimum = findMinimum(n, domain);
+	std::cout << "minimum " << minimum.value << " at x=" << minimum.x << " in [" << minimum.bound.lower << ", " << minimum.bound.upper << "]\n";
+	auto maximum = findMaximum(n, domain);
+	std::cout << "maximum " << maximum.value << " at x=" << maximum.x << " in [" << maximum.bound.lower << ", " << maximum.bound.upper << "]\n";
+
+	std::cout << "<------>\n";
+}
+
+void incrementalTests() {
+	auto x = variable();
+
+	// Fitting a polynomial, changing one coefficient at a time
+	std::vector<NodeRef> coefficients;
+	auto n = constant(0.0f);
+	for (int i = 0; i < 100; i++) {
+		coefficients.push_back(parameter("c" + std::to_string(i), 1.0f));
+		n = n + coefficients.back() * (x ^ static_cast<float>(i));
+	}
+	IncrementalEvaluator evaluator(n);
+	std::cout << "polynomial with " << n.size() << " nodes, value " << evaluator.evaluate(0.5f);
+	std::cout << " after computing " << evaluator.getRecomputed() << " nodes\n";
+	for (int i : {0, 50, 99}) {
+		setParameter(coefficients[i], 2.0f);
+		std::cout << "c" << i << "=2 value " << evaluator.evaluate(0.5f) << " after computing " << evaluator.getRecomputed() << " nodes\n";
+	}
+
+	std::cout << "<------>\n";
+}
+
 int main() {
 	auto x = variable();
 	auto n = 2.0f * x - 2.0f * (x ^ 2);
@@ -187,4 +301,10 @@ int main() {
 
 	simplificationTests();
 	vectorTests();
+	saturationTests();
+	trigonometryTests();
+	integrationTests();
+	antiderivativeTests();
+	intervalTests();
+	incrementalTests();
 }
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "symbolic.h"
+#include "symbolic_internal.h"
+#include <array>
+#include <cmath>
+#include <cstdio>
+
+/*
+	Printing
+
+	Every node has a form, the text around and between its children and its
+	precedence. A child is parenthesized when its precedence is lower than
+	what its position in the parent requires. Forms live in static tables
+	indexed by Format, so printing a node costs one virtual call.
+*/
+
+namespace {
+
+const int kSum = 1;
+const int kProduct = 2;
+const int kPower = 3;
+const int kAtom = 4;
+
+const PrintForm kAtomForm{"", "", "", kAtom, {0, 0}, 0};
+// Negative numbers print like a product, -1 * x, so need parentheses in the same places
+const PrintForm kNegativeForm{"", "", "", kProduct, {0, 0}, 0};
+const PrintForm kVariableForm{"x", "", "", kAtom, {0, 0}, 0};
+
+// Indexed by Format
+const PrintForm kSumForms[] = {
+	{"", " + ", "", kSum, {kSum, kSum}, 2},
+	{"", " + ", "", kSum, {kSum, kSum}, 2},
+	{"(+ ", " ", ")", kAtom, {0, 0}, 2}
+};
+
+const PrintForm kProductForms[] = {
+	{"", " * ", "", kProduct, {kProduct, kProduct}, 2},
+	{"", " \\cdot ", "", kProduct, {kProduct, kProduct}, 2},
+	{"(* ", " ", ")", kAtom, {0, 0}, 2}
+};
+
+const PrintForm kPowerForms[] = {
+	{"", " ^ ", "", kPower, {kAtom, kPower}, 2},
+	{"", "^{", "}", kPower, {kAtom, 0}, 2},
+	{"(^ ", " ", ")", kAtom, {0, 0}, 2}
+};
+
+const PrintForm kIntegralForms[] = {
+	{"∫(", "", ")dx", kAtom, {0, 0}, 1},
+	{"\\int \\left(", "", "\\right) \\, dx", kAtom, {0, 0}, 1},
+	{"(integral ", "", ")", kAtom, {0, 0}, 1}
+};
+
+// Every element printed
+const PrintForm kVectorForms[] = {
+	{"[", ", ", "]", kAtom, {0, 0}, SIZE_MAX},
+	{"\\left[", ", ", "\\right]", kAtom, {0, 0}, SIZE_MAX},
+	{"(vector ", " ", ")", kAtom, {0, 0}, SIZE_MAX}
+};
+
+/*
+	Powers with an exponent of ±1/2, ±1, ±2 or ±3 print without ^, as √, ²
+	or ³, and as a fraction when negative. Indexed by LaTeX or not, then by
+	√, 1, ² and ³, then by the sign of the exponent.
+*/
+using SpecialPowerForms = std::array<std::array<std::array<PrintForm, 2>, 4>, 2>;
+
+const SpecialPowerForms &specialPowerForms() {
+	static const SpecialPowerForms forms = []() {
+		SpecialPowerForms forms;
+		static const char *prefixes[4][2] = {{"√", "1/√"}, {"", "1/"}, {"", "1/"}, {"", "1/"}};
+		static const char *suffixes[4] = {"", "", "²", "³"};
+		static const char *latexPrefixes[4][2] = {{"\\sqrt{", "\\frac{1}{\\sqrt{"}, {"", "\\frac{1}{"}, {"", "\\frac{1}{"}, {"", "\\frac{1}{"}};
+		static const char *latexSuffixes[4][2] = {{"}", "}}"}, {"", "}"}, {"^{2}", "^{2}}"}, {"^{3}", "^{3}}"}};
+		for (size_t kind = 0; kind < 4; kind++) {
+			for (size_t negative = 0; negative < 2; negative++) {
+				int precedence = negative ? kProduct : kind == 1 ? kAtom : kPower;
+				forms[0][kind][negative] = {prefixes[kind][negative], "", suffixes[kind], precedence, {kAtom, 0}, 1};
+				// Braces group the base of a root or a fraction
+				int base = kind == 0 || (kind == 1 && negative) ? 0 : kAtom;
+				precedence = kind >= 2 && !negative ? kPower : kAtom;
+				forms[1][kind][negative] = {latexPrefixes[kind][negative], "", latexSuffixes[kind][negative], precedence, {base, 0}, 1};
+			}
+		}
+		return forms;
+	}();
+	return forms;
+}
+
+// Indexed by FunctionKind, then by Format
+using FunctionForms = std::vector<std::array<PrintForm, 3>>;
+
+const FunctionForms &functionForms() {
+	// Keeps the prefixes the forms point to
+	static std::vector<std::array<std::string, 3>> prefixes;
+	static const FunctionForms forms = []() {
+		FunctionForms forms;
+		for (size_t i = 0; i < kFunctionKindCount; i++) {
+			auto &info = functionInfo(static_cast<FunctionKind>(i));
+			std::string symbol = info.symbol;
+			prefixes.push_back({symbol + "(", std::string(info.latex) + "\\left(", "(" + symbol + " "});
+		}
+		for (size_t i = 0; i < kFunctionKindCount; i++) {
+			forms.push_back({
+				PrintForm{prefixes[i][0].c_str(), "", ")", kAtom, {0, 0}, 1},
+				PrintForm{prefixes[i][1].c_str(), "", "\\right)", kAtom, {0, 0}, 1},
+				PrintForm{prefixes[i][2].c_str(), "", ")", kAtom, {0, 0}, 1}
+			});
+		}
+		forms[static_cast<size_t>(FunctionKind::AbsoluteValue)][1] = {"\\left|", "", "\\right|", kAtom, {0, 0}, 1};
+		return forms;
+	}();
+	return forms;
+}
+
+}
+
+const PrintForm &Node::formLocal(Format format) const {
+	static const PrintForm unknown{"?", "", "", kAtom, {0, 0}, 0};
+	return unknown;
+}
+
+// Constant
+const PrintForm &Constant::formLocal(Format format) const {
+	return fValue < 0.0f && format != Format::SExpression ? kNegativeForm : kAtomForm;
+}
+
+// Same as the default formatting of std::ostream
+void Constant::printLocal(std::string &text) const {
+	// Most constants are small integers, printed without snprintf
+	if (fValue == std::trunc(fValue) && std::abs(fValue) < 1e6f && !(fValue == 0.0f && std::signbit(fValue))) {
+		char digits[8];
+		size_t length = 0;
+		for (int value = static_cast<int>(std::abs(fValue)); value > 0 || length == 0; value /= 10) {
+			digits[length++] = static_cast<char>('0' + value % 10);
+		}
+		if (fValue < 0.0f) {
+			text.push_back('-');
+		}
+		while (length > 0) {
+			text.push_back(digits[--length]);
+		}
+		return;
+	}
+	char number[32];
+	int length = std::snprintf(number, sizeof(number), "%g", fValue);
+	text.append(number, length);
+}
+
+// Variable
+const PrintForm &Variable::formLocal(Format format) const {
+	return kVariableForm;
+}
+
+// Parameter
+const PrintForm &Parameter::formLocal(Format format) const {
+	return kAtomForm;
+}
+
+void Parameter::printLocal(std::string &text) const {
+	text.append(fName);
+}
+
+// Vector
+const PrintForm &Vector::formLocal(Format format) const {
+	return kVectorForms[static_cast<size_t>(format)];
+}
+
+// Sum
+const PrintForm &Sum::formLocal(Format format) const {
+	return kSumForms[static_cast<size_t>(format)];
+}
+
+// Product
+const PrintForm &Product::formLocal(Format format) const {
+	return kProductForms[static_cast<size_t>(format)];
+}
+
+// Power
+const PrintForm &Power::formLocal(Format format) const {
+	auto exponent = format != Format::SExpression ? toConstant(fExponent) : nullptr;
+	if (exponent) {
+		float absExponent = std::abs(exponent->fValue);
+		size_t kind = absExponent == 0.5f ? 0 : absExponent == 1.0f ? 1 : absExponent == 2.0f ? 2 : absExponent == 3.0f ? 3 : 4;
+		if (kind < 4) {
+			return specialPowerForms()[format == Format::LaTeX][kind][exponent->fValue < 0.0f];
+		}
+	}
+	return kPowerForms[static_cast<size_t>(format)];
+}
+
+// Function
+const PrintForm &Function::formLocal(Format format) const {
+	return functionForms()[static_cast<size_t>(fKind)][static_cast<size_t>(format)];
+}
+
+// Integral
+const PrintForm &Integral::formLocal(Format format) const {
+	return kIntegralForms[static_cast<size_t>(format)];
+}
+
+const std::string &Printer::print(const NodeRef &node) {
+	const char *open = fFormat == Format::LaTeX ? "\\left(" : "(";
+	const char *close = fFormat == Format::LaTeX ? "\\right)" : ")";
+	fBuffer.clear();
+	fFrames.clear();
+	auto root = node.fRef.get();
+	fFrames.push_back({root, &root->formLocal(fFormat), 0, false});
+	while (!fFrames.empty()) {
+		auto &frame = fFrames.back();
+		auto &form = *frame.form;
+		size_t position = frame.position++;
+		size_t count = frame.node->getChildCount();
+		size_t printed = form.printed < count ? form.printed : count;
+		if (position == 0) {
+			if (frame.parenthesized) {
+				fBuffer.append(open);
+			}
+			fBuffer.append(form.prefix);
+			if (count == 0) {
+				frame.node->printLocal(fBuffer);
+			}
+		}
+		else if (position < printed) {
+			fBuffer.append(form.infix);
+		}
+		if (position < printed) {
+			auto child = frame.node->getChild(position).get();
+			auto &childForm = child->formLocal(fFormat);
+			int minimum = form.childPrecedence[position < 2 ? position : 1];
+			// Invalidates frame
+			fFrames.push_back({child, &childForm, 0, childForm.precedence < minimum});
+			continue;
+		}
+		fBuffer.append(form.suffix);
+		if (frame.parenthesized) {
+			fBuffer.append(close);
+		}
+		fFrames.pop_back();
+	}
+	return fBuffer;
+}
@@ -0,0 +1,77 @@
+#include "symbolic.h"
+#include <algorithm>
+#include <cmath>
+
+/*
+	Batched Newton and Halley iteration
+
+	The derivatives are derived and simplified once. Every iteration
+	evaluates them for all points still iterating in batches of kBatchSize,
+	points that converge or fail are dropped so the batches stay full.
+*/
+
+std::vector<Solution> solve(const NodeRef &node, const std::vector<float> &starts, const SolverOptions &options) {
+	auto f = node;
+	auto derivative = f.derive().simplify();
+	bool halley = options.method == SolverMethod::Halley;
+	auto second = halley ? derivative.derive().simplify() : derivative;
+
+	std::vector<Solution> solutions(starts.size());
+	std::vector<size_t> active(starts.size());
+	std::vector<float> x(starts.size());
+	for (size_t i = 0; i < starts.size(); i++) {
+		solutions[i] = {starts[i], 0.0f, 0, false};
+		active[i] = i;
+		x[i] = starts[i];
+	}
+
+	std::vector<float> values(starts.size()), slopes(starts.size()), curvatures(halley ? starts.size() : 0);
+	for (size_t iteration = 0; iteration < options.maxIterations && !active.empty(); iteration++) {
+		size_t count = active.size();
+		f.evaluate(x.data(), values.data(), count);
+		derivative.evaluate(x.data(), slopes.data(), count);
+		if (halley) {
+			second.evaluate(x.data(), curvatures.data(), count);
+		}
+
+		// Lane i works on point active[i], lanes still iterating move to the front
+		size_t kept = 0;
+		for (size_t i = 0; i < count; i++) {
+			auto &solution = solutions[active[i]];
+			float value = values[i];
+			float slope = slopes[i];
+			// f(x) - f'(x) * step = 0, or with Halley's correction for f''(x)
+			float step = halley ?
+				2.0f * value * slope / (2.0f * slope * slope - value * curvatures[i]) :
+				value / slope;
+			if (value == 0.0f) {
+				solution.converged = true;
+				continue;
+			}
+			if (!std::isfinite(step)) {
+				continue;
+			}
+			float next = x[i] - step;
+			solution.root = next;
+			solution.iterations++;
+			if (std::abs(step) <= options.tolerance * std::max(1.0f, std::abs(next))) {
+				solution.converged = true;
+				continue;
+			}
+			active[kept] = active[i];
+			x[kept] = next;
+			kept++;
+		}
+		active.resize(kept);
+	}
+
+	// Values at the roots, in one more batched evaluation
+	for (size_t i = 0; i < solutions.size(); i++) {
+		x[i] = solutions[i].root;
+	}
+	f.evaluate(x.data(), values.data(), solutions.size());
+	for (size_t i = 0; i < solutions.size(); i++) {
+		solutions[i].value = values[i];
+	}
+	return solutions;
+}
@@ -0,0 +1,439 @@
+#pragma once
+#include "symbolic.h"
+#include <climits>
+#include <cmath>
+#include <type_traits>
+
+/*
+	Expressions fixed at compile time
+
+	Every node is an empty type whose template arguments are its children,
+	so evaluate() inlines into straight line code with no interpretation.
+	Derivatives and simplifications are types as well, computed by the
+	compiler, and toNodeRef() converts any of them to the runtime tree for
+	printing and comparison.
+
+		constexpr StaticVariable x;
+		auto f = staticConstant<3> * (x ^ staticConstant<2>) + sin(x);
+		auto df = derive(f);	// 3 * 2 * x ^ 1 folds to 6 * x
+		float value = df(0.5f);
+
+	Constants are rationals N / D so that folding them stays exact.
+*/
+
+// Base of all static expressions
+struct StaticExpression {};
+
+template <typename T>
+constexpr bool isStatic = std::is_base_of<StaticExpression, T>::value;
+
+// Gives every node the call operator, evaluating at x
+template <typename E>
+struct StaticNode : StaticExpression {
+	float operator()(float x) const {
+		return E::evaluate(x);
+	}
+};
+
+// Scalars
+constexpr long long staticGcd(long long a, long long b) {
+	return b ? staticGcd(b, a % b) : (a < 0 ? -a : a);
+}
+
+// Use StaticRational to get N / D in lowest terms
+template <int N, int D = 1>
+struct StaticConstant : StaticNode<StaticConstant<N, D>> {
+	static_assert(D > 0, "The sign of a constant is in its numerator");
+
+	static constexpr int numerator = N;
+	static constexpr int denominator = D;
+	static constexpr float value = static_cast<float>(N) / static_cast<float>(D);
+
+	static constexpr float evaluate(float x) { return value; }
+	static NodeRef node() { return constant(value); }
+};
+
+template <long long N, long long D>
+struct StaticReduce {
+	static constexpr long long numerator = (D < 0 ? -N : N) / staticGcd(N, D);
+	static constexpr long long denominator = (D < 0 ? -D : D) / staticGcd(N, D);
+	// Folding multiplies numerators and denominators, which may leave the range of int
+	static_assert(numerator >= INT_MIN && numerator <= INT_MAX && denominator <= INT_MAX, "Constant out of the range of int");
+
+	using Type = StaticConstant<static_cast<int>(numerator), static_cast<int>(denominator)>;
+};
+
+template <long long N, long long D>
+using StaticRational = typename StaticReduce<N, D>::Type;
+
+template <int N, int D = 1>
+constexpr StaticRational<N, D> staticConstant{};
+
+struct StaticVariable : StaticNode<StaticVariable> {
+	static constexpr float evaluate(float x) { return x; }
+	static NodeRef node() { return variable(); }
+};
+
+// Functions
+template <typename L, typename R>
+struct StaticSum : StaticNode<StaticSum<L, R>> {
+	static constexpr float evaluate(float x) { return L::evaluate(x) + R::evaluate(x); }
+	static NodeRef node() { return L::node() + R::node(); }
+};
+
+template <typename L, typename R>
+struct StaticProduct : StaticNode<StaticProduct<L, R>> {
+	using Left = L;
+	using Right = R;
+
+	static constexpr float evaluate(float x) { return L::evaluate(x) * R::evaluate(x); }
+	static NodeRef node() { return L::node() * R::node(); }
+};
+
+template <typename T>
+constexpr bool isStaticConstant = false;
+
+template <int N, int D>
+constexpr bool isStaticConstant<StaticConstant<N, D>> = true;
+
+template <typename T>
+constexpr bool isStaticInteger = false;
+
+template <int N>
+constexpr bool isStaticInteger<StaticConstant<N, 1>> = true;
+
+template <typename T>
+constexpr bool isStaticProduct = false;
+
+template <typename L, typename R>
+constexpr bool isStaticProduct<StaticProduct<L, R>> = true;
+
+// Integer exponents multiply out by squaring
+template <int N>
+constexpr float staticPower(float base) {
+	if constexpr (N < 0) {
+		return 1.0f / staticPower<-N>(base);
+	}
+	else if constexpr (N == 0) {
+		return 1.0f;
+	}
+	else if constexpr (N % 2) {
+		return base * staticPower<N - 1>(base);
+	}
+	else {
+		float half = staticPower<N / 2>(base);
+		return half * half;
+	}
+}
+
+template <typename B, typename E>
+struct StaticPower : StaticNode<StaticPower<B, E>> {
+	using Base = B;
+	using Exponent = E;
+
+	static constexpr float evaluate(float x) {
+		if constexpr (isStaticInteger<E>) {
+			return staticPower<E::numerator>(B::evaluate(x));
+		}
+		else if constexpr (std::is_same<E, StaticConstant<1, 2>>::value) {
+			return sqrtf(B::evaluate(x));
+		}
+		else {
+			return powf(B::evaluate(x), E::evaluate(x));
+		}
+	}
+	static NodeRef node() { return B::node() ^ E::node(); }
+};
+
+template <typename T>
+constexpr bool isStaticPower = false;
+
+template <typename B, typename E>
+constexpr bool isStaticPower<StaticPower<B, E>> = true;
+
+template <FunctionKind K, typename A>
+struct StaticFunction : StaticNode<StaticFunction<K, A>> {
+	static float evaluate(float x) { return kFunctionValues[static_cast<size_t>(K)](A::evaluate(x)); }
+	static NodeRef node() { return function(K, A::node()); }
+};
+
+// Greater than zero wherever defined, a positive constant or an exponential
+template <typename T>
+constexpr bool isStaticPositive = false;
+
+template <int N, int D>
+constexpr bool isStaticPositive<StaticConstant<N, D>> = N > 0;
+
+template <typename A>
+constexpr bool isStaticPositive<StaticFunction<FunctionKind::Exponential, A>> = true;
+
+template <typename T>
+constexpr bool isStaticEven = false;
+
+template <int N>
+constexpr bool isStaticEven<StaticConstant<N, 1>> = N % 2 == 0;
+
+// Folding
+/*
+	The constructors used for derivatives and simplification, applying the
+	rules that need no search: constants fold, 0 and 1 disappear and
+	constant factors move to the left where they merge.
+*/
+template <typename L, typename R>
+constexpr auto staticAdd(L, R) {
+	if constexpr (isStaticConstant<L> && isStaticConstant<R>) {
+		return StaticRational<
+			static_cast<long long>(L::numerator) * R::denominator + static_cast<long long>(R::numerator) * L::denominator,
+			static_cast<long long>(L::denominator) * R::denominator>{};
+	}
+	else if constexpr (std::is_same<L, StaticConstant<0>>::value) {
+		return R{};
+	}
+	else if constexpr (std::is_same<R, StaticConstant<0>>::value) {
+		return L{};
+	}
+	else {
+		return StaticSum<L, R>{};
+	}
+}
+
+template <typename L, typename R>
+constexpr auto staticMultiply(L, R) {
+	if constexpr (isStaticConstant<L> && isStaticConstant<R>) {
+		return StaticRational<
+			static_cast<long long>(L::numerator) * R::numerator,
+			static_cast<long long>(L::denominator) * R::denominator>{};
+	}
+	else if constexpr (std::is_same<L, StaticConstant<0>>::value || std::is_same<R, StaticConstant<0>>::value) {
+		return StaticConstant<0>{};
+	}
+	else if constexpr (std::is_same<L, StaticConstant<1>>::value) {
+		return R{};
+	}
+	else if constexpr (std::is_same<R, StaticConstant<1>>::value) {
+		return L{};
+	}
+	else if constexpr (isStaticConstant<R>) {
+		return staticMultiply(R{}, L{});
+	}
+	else if constexpr (isStaticConstant<L> && isStaticProduct<R>) {
+		// n * (m * a) = (n * m) * a
+		if constexpr (isStaticConstant<typename R::Left>) {
+			return staticMultiply(staticMultiply(L{}, typename R::Left{}), typename R::Right{});
+		}
+		else {
+			return StaticProduct<L, R>{};
+		}
+	}
+	else {
+		return StaticProduct<L, R>{};
+	}
+}
+
+template <typename B, typename E>
+constexpr auto staticRaise(B, E) {
+	if constexpr (std::is_same<E, StaticConstant<0>>::value) {
+		return StaticConstant<1>{};
+	}
+	else if constexpr (std::is_same<E, StaticConstant<1>>::value) {
+		return B{};
+	}
+	else if constexpr (isStaticPower<B>) {
+		using Base = typename B::Base;
+		using Exponent = typename B::Exponent;
+		// (a ^ n) ^ m = a ^ (n * m), only where both sides agree for negative a
+		if constexpr (isStaticPositive<Base> || (isStaticInteger<Exponent> && isStaticInteger<E>)) {
+			return staticRaise(Base{}, staticMultiply(Exponent{}, E{}));
+		}
+		// (a ^ 2k) ^ m = abs(a) ^ (2k * m)
+		else if constexpr (isStaticEven<Exponent>) {
+			return staticRaise(StaticFunction<FunctionKind::AbsoluteValue, Base>{}, staticMultiply(Exponent{}, E{}));
+		}
+		else {
+			return StaticPower<B, E>{};
+		}
+	}
+	else {
+		return StaticPower<B, E>{};
+	}
+}
+
+template <typename L, typename R>
+using StaticAdd = decltype(staticAdd(L{}, R{}));
+
+template <typename L, typename R>
+using StaticMultiply = decltype(staticMultiply(L{}, R{}));
+
+template <typename B, typename E>
+using StaticRaise = decltype(staticRaise(B{}, E{}));
+
+// Simplification
+/*
+	One bottom-up pass of the folding constructors, enough since every
+	level is folded before its parent is built
+*/
+template <typename E>
+struct StaticSimplify {
+	using Type = E;
+};
+
+template <typename E>
+using StaticSimplified = typename StaticSimplify<E>::Type;
+
+template <typename L, typename R>
+struct StaticSimplify<StaticSum<L, R>> {
+	using Type = StaticAdd<StaticSimplified<L>, StaticSimplified<R>>;
+};
+
+template <typename L, typename R>
+struct StaticSimplify<StaticProduct<L, R>> {
+	using Type = StaticMultiply<StaticSimplified<L>, StaticSimplified<R>>;
+};
+
+template <typename B, typename E>
+struct StaticSimplify<StaticPower<B, E>> {
+	using Type = StaticRaise<StaticSimplified<B>, StaticSimplified<E>>;
+};
+
+template <FunctionKind K, typename A>
+struct StaticSimplify<StaticFunction<K, A>> {
+	using Type = StaticFunction<K, StaticSimplified<A>>;
+};
+
+// Derivative
+template <typename E>
+struct StaticDerive;
+
+template <typename E>
+using StaticDerivative = typename StaticDerive<E>::Type;
+
+template <int N, int D>
+struct StaticDerive<StaticConstant<N, D>> {
+	using Type = StaticConstant<0>;
+};
+
+template <>
+struct StaticDerive<StaticVariable> {
+	using Type = StaticConstant<1>;
+};
+
+template <typename L, typename R>
+struct StaticDerive<StaticSum<L, R>> {
+	using Type = StaticAdd<StaticDerivative<L>, StaticDerivative<R>>;
+};
+
+template <typename L, typename R>
+struct StaticDerive<StaticProduct<L, R>> {
+	using Type = StaticAdd<StaticMultiply<StaticDerivative<L>, R>, StaticMultiply<L, StaticDerivative<R>>>;
+};
+
+// Same rules as Power::deriveLocal()
+template <typename B, typename E>
+constexpr auto staticDerivePower() {
+	using Base = StaticDerivative<B>;
+	if constexpr (isStaticConstant<E>) {
+		// (b ^ c)' = c * b ^ (c - 1) * b'
+		using Exponent = StaticRational<static_cast<long long>(E::numerator) - E::denominator, E::denominator>;
+		return staticMultiply(staticMultiply(E{}, staticRaise(B{}, Exponent{})), Base{});
+	}
+	else {
+		// (b ^ e)' = b ^ e * (e' * ln(b) + e * b' * b ^ -1)
+		using Logarithm = StaticFunction<FunctionKind::NaturalLogarithm, B>;
+		using Inverse = StaticRaise<B, StaticConstant<-1>>;
+		return staticMultiply(StaticPower<B, E>{}, staticAdd(
+			staticMultiply(StaticDerivative<E>{}, Logarithm{}),
+			staticMultiply(E{}, staticMultiply(Base{}, Inverse{}))));
+	}
+}
+
+template <typename B, typename E>
+struct StaticDerive<StaticPower<B, E>> {
+	using Type = decltype(staticDerivePower<B, E>());
+};
+
+// f'(u) for every row of the function table
+template <FunctionKind K, typename A>
+constexpr auto staticDeriveFunction() {
+	if constexpr (K == FunctionKind::NaturalLogarithm) {
+		return StaticRaise<A, StaticConstant<-1>>{};
+	}
+	else if constexpr (K == FunctionKind::Cosine) {
+		return StaticMultiply<StaticConstant<-1>, StaticFunction<FunctionKind::Sine, A>>{};
+	}
+	else if constexpr (K == FunctionKind::Sine) {
+		return StaticFunction<FunctionKind::Cosine, A>{};
+	}
+	else if constexpr (K == FunctionKind::Exponential) {
+		return StaticFunction<FunctionKind::Exponential, A>{};
+	}
+	else if constexpr (K == FunctionKind::Tangent) {
+		return StaticRaise<StaticFunction<FunctionKind::Cosine, A>, StaticConstant<-2>>{};
+	}
+	else if constexpr (K == FunctionKind::AbsoluteValue) {
+		return StaticFunction<FunctionKind::Sign, A>{};
+	}
+	else if constexpr (K == FunctionKind::HyperbolicTangent) {
+		using Square = StaticRaise<StaticFunction<FunctionKind::HyperbolicTangent, A>, StaticConstant<2>>;
+		return StaticAdd<StaticConstant<1>, StaticMultiply<StaticConstant<-1>, Square>>{};
+	}
+	else {
+		return StaticConstant<0>{};
+	}
+}
+
+template <FunctionKind K, typename A>
+struct StaticDerive<StaticFunction<K, A>> {
+	using Type = StaticMultiply<decltype(staticDeriveFunction<K, A>()), StaticDerivative<A>>;
+};
+
+// Operators, building the expression as written like those of NodeRef
+template <typename L, typename R, typename = std::enable_if_t<isStatic<L> && isStatic<R>>>
+constexpr StaticSum<L, R> operator+(L, R) { return {}; }
+
+template <typename L, typename R, typename = std::enable_if_t<isStatic<L> && isStatic<R>>>
+constexpr StaticSum<L, StaticProduct<StaticConstant<-1>, R>> operator-(L, R) { return {}; }
+
+template <typename L, typename R, typename = std::enable_if_t<isStatic<L> && isStatic<R>>>
+constexpr StaticProduct<L, R> operator*(L, R) { return {}; }
+
+template <typename L, typename R, typename = std::enable_if_t<isStatic<L> && isStatic<R>>>
+constexpr StaticProduct<L, StaticPower<R, StaticConstant<-1>>> operator/(L, R) { return {}; }
+
+template <typename B, typename E, typename = std::enable_if_t<isStatic<B> && isStatic<E>>>
+constexpr StaticPower<B, E> operator^(B, E) { return {}; }
+
+template <typename A, typename = std::enable_if_t<isStatic<A>>>
+constexpr StaticPower<A, StaticConstant<1, 2>> sqrt(A) { return {}; }
+
+template <typename A, typename = std::enable_if_t<isStatic<A>>>
+constexpr StaticFunction<FunctionKind::NaturalLogarithm, A> ln(A) { return {}; }
+
+template <typename A, typename = std::enable_if_t<isStatic<A>>>
+constexpr StaticFunction<FunctionKind::Cosine, A> cos(A) { return {}; }
+
+template <typename A, typename = std::enable_if_t<isStatic<A>>>
+constexpr StaticFunction<FunctionKind::Sine, A> sin(A) { return {}; }
+
+template <typename A, typename = std::enable_if_t<isStatic<A>>>
+constexpr StaticFunction<FunctionKind::Exponential, A> exp(A) { return {}; }
+
+template <typename A, typename = std::enable_if_t<isStatic<A>>>
+constexpr StaticFunction<FunctionKind::Tangent, A> tan(A) { return {}; }
+
+template <typename A, typename = std::enable_if_t<isStatic<A>>>
+constexpr StaticFunction<FunctionKind::AbsoluteValue, A> abs(A) { return {}; }
+
+template <typename A, typename = std::enable_if_t<isStatic<A>>>
+constexpr StaticFunction<FunctionKind::HyperbolicTangent, A> tanh(A) { return {}; }
+
+template <typename E, typename = std::enable_if_t<isStatic<E>>>
+constexpr StaticDerivative<E> derive(E) { return {}; }
+
+template <typename E, typename = std::enable_if_t<isStatic<E>>>
+constexpr StaticSimplified<E> simplify(E) { return {}; }
+
+// Runtime tree of the expression
+template <typename E, typename = std::enable_if_t<isStatic<E>>>
+NodeRef toNodeRef(E) {
+	return E::node();
+}
@@ -1,41 +1,46 @@
 #include "symbolic.h"
 #include "symbolic_internal.h"
 #include <algorithm>
+#include <cmath>
 
-NodeRef operator+(const NodeRef &left, const NodeRef &right) {
-	return NodeRef(newSum(left.fRef, right.fRef));
+/*
+	Operands are taken by value and moved into the new node, so temporaries
+	such as the (x ^ 2) in 3 * (x ^ 2) cost no reference count updates
+*/
+NodeRef operator+(NodeRef left, NodeRef right) {
+	return NodeRef(newSum(std::move(left.fRef), std::move(right.fRef)));
 }
 
-NodeRef operator-(const NodeRef &left, const NodeRef &right) {
-	return NodeRef(newSum(left.fRef, newProduct(newConstant(-1.0f), right.fRef)));
+NodeRef operator-(NodeRef left, NodeRef right) {
+	return NodeRef(newSum(std::move(left.fRef), newProduct(newConstant(-1.0f), std::move(right.fRef))));
 }
 
-NodeRef operator*(float left, const NodeRef &right) {
-	return NodeRef(newProduct(newConstant(left), right.fRef));
+NodeRef operator*(float left, NodeRef right) {
+	return NodeRef(newProduct(newConstant(left), std::move(right.fRef)));
 }
 
-NodeRef operator*(const NodeRef &left, const NodeRef &right) {
-	return NodeRef(newProduct(left.fRef, right.fRef));
+NodeRef operator*(NodeRef left, NodeRef right) {
+	return NodeRef(newProduct(std::move(left.fRef), std::move(right.fRef)));
 }
 
-NodeRef operator/(float left, const NodeRef &right) {
-	return NodeRef(newProduct(newConstant(left), newPower(right.fRef, newConstant(-1.0f))));
+NodeRef operator/(float left, NodeRef right) {
+	return NodeRef(newProduct(newConstant(left), newPower(std::move(right.fRef), newConstant(-1.0f))));
 }
 
-NodeRef operator/(const NodeRef &left, const NodeRef &right) {
-	return NodeRef(newProduct(left.fRef, newPower(right.fRef, newConstant(-1.0f))));
+NodeRef operator/(NodeRef left, NodeRef right) {
+	return NodeRef(newProduct(std::move(left.fRef), newPower(std::move(right.fRef), newConstant(-1.0f))));
 }
 
-NodeRef operator^(const NodeRef &base, float exponent) {
-	return NodeRef(newPower(base.fRef, newConstant(exponent)));
+NodeRef operator^(NodeRef base, float exponent) {
+	return NodeRef(newPower(std::move(base.fRef), newConstant(exponent)));
 }
 
-NodeRef operator^(float base, const NodeRef &exponent) {
-	return NodeRef(newPower(newConstant(base), exponent.fRef));
+NodeRef operator^(float base, NodeRef exponent) {
+	return NodeRef(newPower(newConstant(base), std::move(exponent.fRef)));
 }
 
-NodeRef operator^(const NodeRef &base, const NodeRef &exponent) {
-	return NodeRef(newPower(base.fRef, exponent.fRef));
+NodeRef operator^(NodeRef base, NodeRef exponent) {
+	return NodeRef(newPower(std::move(base.fRef), std::move(exponent.fRef)));
 }
 
 std::ostream &operator<< (std::ostream &stream, const NodeRef &reference) {
@@ -58,20 +63,61 @@ NodeRef vec2(const NodeRef &x, const NodeRef &y) {
 	return NodeRef(newVector({x.fRef, y.fRef}));
 }
 
-NodeRef sqrt(const NodeRef &argument) {
-	return NodeRef(newSquareRoot(argument.fRef));
+NodeRef vec(const std::vector<NodeRef> &elements) {
+	std::vector<std::shared_ptr<Node>> nodes;
+	nodes.reserve(elements.size());
+	for (auto &element : elements) {
+		nodes.push_back(element.fRef);
+	}
+	return NodeRef(newVector(std::move(nodes)));
+}
+
+NodeRef parameter(const std::string &name, float value) {
+	return NodeRef(newParameter(name, value));
+}
+
+void setParameter(const NodeRef &parameter, float value) {
+	auto node = toParameter(parameter.fRef);
+	if (!node) {
+		throw std::invalid_argument("setParameter() of a node that is not a parameter");
+	}
+	node->fValue = value;
+}
+
+NodeRef sqrt(NodeRef argument) {
+	return NodeRef(newSquareRoot(std::move(argument.fRef)));
+}
+
+NodeRef ln(NodeRef argument) {
+	return NodeRef(newNaturalLogarithm(std::move(argument.fRef)));
+}
+
+NodeRef cos(NodeRef argument) {
+	return NodeRef(newCosine(std::move(argument.fRef)));
+}
+
+NodeRef sin(NodeRef argument) {
+	return NodeRef(newSine(std::move(argument.fRef)));
+}
+
+NodeRef exp(NodeRef argument) {
+	return NodeRef(newExponential(std::move(argument.fRef)));
+}
+
+NodeRef tan(NodeRef argument) {
+	return NodeRef(newFunction(FunctionKind::Tangent, std::move(argument.fRef)));
 }
 
-NodeRef ln(const NodeRef &argument) {
-	return NodeRef(newNaturalLogarithm(argument.fRef));
+NodeRef abs(NodeRef argument) {
+	return NodeRef(newFunction(FunctionKind::AbsoluteValue, std::move(argument.fRef)));
 }
 
-NodeRef cos(const NodeRef &argument) {
-	return NodeRef(newCosine(argument.fRef));
+NodeRef tanh(NodeRef argument) {
+	return NodeRef(newFunction(FunctionKind::HyperbolicTangent, std::move(argument.fRef)));
 }
 
-NodeRef sin(const NodeRef &argument) {
-	return NodeRef(newSine(argument.fRef));
+NodeRef function(FunctionKind kind, NodeRef argument) {
+	return NodeRef(newFunction(kind, std::move(argument.fRef)));
 }
 
 NodeRef dot(const NodeRef &left, const NodeRef &right) {
@@ -92,29 +138,100 @@ NodeRef dot(const NodeRef &left, const NodeRef &right) {
 	}
 }
 
+// Builders
+NodeRef sum(std::vector<NodeRef> terms) {
+	if (terms.empty()) {
+		return constant(0.0f);
+	}
+	auto result = std::move(terms.front().fRef);
+	for (size_t i = 1; i < terms.size(); i++) {
+		result = newSum(std::move(result), std::move(terms[i].fRef));
+	}
+	return NodeRef(std::move(result));
+}
+
+NodeRef product(std::vector<NodeRef> factors) {
+	if (factors.empty()) {
+		return constant(1.0f);
+	}
+	auto result = std::move(factors.front().fRef);
+	for (size_t i = 1; i < factors.size(); i++) {
+		result = newProduct(std::move(result), std::move(factors[i].fRef));
+	}
+	return NodeRef(std::move(result));
+}
+
+/*
+	Horner form, n multiplications and at most n additions instead of the
+	powers of the expanded form. Zero coefficients add nothing.
+*/
+NodeRef polynomial(const std::vector<float> &coefficients, const NodeRef &x) {
+	if (coefficients.empty()) {
+		return constant(0.0f);
+	}
+	std::shared_ptr<Node> result = newConstant(coefficients.back());
+	for (size_t i = coefficients.size() - 1; i > 0; i--) {
+		result = newProduct(std::move(result), x.fRef);
+		if (coefficients[i - 1] != 0.0f) {
+			result = newSum(std::move(result), newConstant(coefficients[i - 1]));
+		}
+	}
+	return NodeRef(std::move(result));
+}
+
+// Returns u when node is f(u) ^ 2 with f a function of the given kind
+std::shared_ptr<Node> squaredArgument(const std::shared_ptr<Node> &node, FunctionKind kind) {
+	if (isPower(node)) {
+		auto power = toPower(node);
+		auto function = toFunction(power->fBase, kind);
+		if (function && isConstant(power->fExponent) && toConstant(power->fExponent)->fValue == 2.0f) {
+			return function->fArgument;
+		}
+	}
+	return nullptr;
+}
+
+// True when node is greater than zero wherever it is defined
+bool isPositive(const std::shared_ptr<Node> &node) {
+	return (isConstant(node) && toConstant(node)->fValue > 0.0f) || isExponential(node);
+}
+
+bool isEvenInteger(float value) {
+	return fmodf(value, 2.0f) == 0.0f;
+}
+
 // Constant
+std::shared_ptr<Constant> cachedConstant(float value) {
+	thread_local const std::shared_ptr<Constant> constants[] = {
+		std::make_shared<Constant>(0.0f),
+		std::make_shared<Constant>(1.0f),
+		std::make_shared<Constant>(-1.0f),
+		std::make_shared<Constant>(2.0f)
+	};
+	return constants[value == 0.0f ? 0 : value == 1.0f ? 1 : value == -1.0f ? 2 : 3];
+}
+
 /* 
 	The derivative of a constant is zero
 */
-std::shared_ptr<Node> Constant::derive() {
+std::shared_ptr<Node> Constant::deriveLocal(const std::shared_ptr<Node> *derivatives) {
 		return newConstant(0.0f);
 }
 
-float Constant::evaluate(float x) {
+float Constant::evaluateLocal(float x, const float *arguments) {
 	return fValue;
 }
 
-std::shared_ptr<Node> Constant::simplify() {
-	return shared_from_this();
+void Constant::evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) {
+	std::fill(result, result + count, fValue);
 }
 
-std::ostream &Constant::out(std::ostream &stream) const {
+void Constant::outLocal(std::ostream &stream, size_t position) const {
 	stream << fValue;
-	return stream;
 }
 
-bool Constant::equals(const std::shared_ptr<Node> &other) const {
-	auto constant = toConstant(other);
+bool Constant::equalsLocal(const Node &other) const {
+	auto constant = dynamic_cast<const Constant*>(&other);
 	return constant && constant->fValue == fValue;
 }
 
@@ -122,75 +239,99 @@ bool Constant::equals(const std::shared_ptr<Node> &other) const {
 /* 
 	The derivative of a variable is one
 */
-std::shared_ptr<Node> Variable::derive() {
+std::shared_ptr<Node> Variable::deriveLocal(const std::shared_ptr<Node> *derivatives) {
 	return newConstant(1.0f);
 }
 
-float Variable::evaluate(float x) {
+float Variable::evaluateLocal(float x, const float *arguments) {
 	return x;
 }
 
-std::shared_ptr<Node> Variable::simplify() {
-	return shared_from_this();
+void Variable::evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) {
+	std::copy(x, x + count, result);
 }
 
-std::ostream &Variable::out(std::ostream &stream) const {
+void Variable::outLocal(std::ostream &stream, size_t position) const {
 	stream << "x";
-	return stream;
 }
 
-bool Variable::equals(const std::shared_ptr<Node> &other) const {
-	auto variable = toVariable(other);
-	return variable != nullptr;
+bool Variable::equalsLocal(const Node &other) const {
+	return dynamic_cast<const Variable*>(&other) != nullptr;
+}
+
+// Parameter
+/*
+	A parameter is constant with respect to x
+*/
+std::shared_ptr<Node> Parameter::deriveLocal(const std::shared_ptr<Node> *derivatives) {
+	return newConstant(0.0f);
+}
+
+float Parameter::evaluateLocal(float x, const float *arguments) {
+	return fValue;
+}
+
+void Parameter::evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) {
+	std::fill(result, result + count, fValue);
+}
+
+void Parameter::outLocal(std::ostream &stream, size_t position) const {
+	stream << fName;
+}
+
+// Parameters are only equal to themselves, whatever their names and values
+bool Parameter::equalsLocal(const Node &other) const {
+	return this == &other;
 }
 
 // Vector
 Vector::Vector(std::initializer_list<std::shared_ptr<Node>> nodes) : 
 elements(nodes) {
-
+	for (auto &element : elements) {
+		addChild(element);
+	}
 }
 
 Vector::Vector(std::vector<std::shared_ptr<Node>> &&nodes) : 
-elements(nodes) {
+elements(std::move(nodes)) {
+	for (auto &element : elements) {
+		addChild(element);
+	}
+}
 
+Vector::~Vector() {
+	for (auto &element : elements) {
+		release(element);
+	}
 }
 
-std::shared_ptr<Node> Vector::derive() {
-	std::vector<std::shared_ptr<Node>> s;
-	s.resize(elements.size());
-	std::transform(elements.begin(), elements.end(), s.begin(), [](auto &e){ 		return e->derive();
-	});
-	return newVector(std::move(s));
+std::shared_ptr<Node> Vector::deriveLocal(const std::shared_ptr<Node> *derivatives) {
+	return newVector(std::vector<std::shared_ptr<Node>>(derivatives, derivatives + elements.size()));
 }
 
-float Vector::evaluate(float x) {
+float Vector::evaluateLocal(float x, const float *arguments) {
 	return 0.0f;
 }
 
-std::shared_ptr<Node> Vector::simplify() {
-	std::vector<std::shared_ptr<Node>> s;
-	s.resize(elements.size());
-	std::transform(elements.begin(), elements.end(), s.begin(), [](auto &e){ 		return e->simplify();
-	});
-	return newVector(std::move(s));
+std::shared_ptr<Node> Vector::withChildren(const std::shared_ptr<Node> *children) {
+	return newVector(std::vector<std::shared_ptr<Node>>(children, children + elements.size()));
 }
 
-std::ostream &Vector::out(std::ostream &stream) const {
-	bool first = true;
-	stream << "[";
-	for (auto &element : elements) {
-		if (!first) { stream << ", "; } else { first = false; }
-		element->out(stream);
+void Vector::outLocal(std::ostream &stream, size_t position) const {
+	if (position == 0) {
+		stream << "[";
+	}
+	else if (position < elements.size()) {
+		stream << ", ";
+	}
+	if (position == elements.size()) {
+		stream << "]";
 	}
-	stream << "]";
-	return stream;
 }
 
-bool Vector::equals(const std::shared_ptr<Node> &other) const {
-	auto vector = toVector(other);
-	return vector && vector->getDimension() == getDimension() && std::equal(elements.begin(), elements.end(), vector->elements.begin(), [](auto &a, auto &b){
-		return a->equals(b);
-	});
+bool Vector::equalsLocal(const Node &other) const {
+	auto vector = dynamic_cast<const Vector*>(&other);
+	return vector && vector->getDimension() == getDimension();
 }
 
 // Sum
@@ -198,36 +339,57 @@ bool Vector::equals(const std::shared_ptr<Node> &other) const {
 	The derivative of a sum is the sum of the derivatives
 	(a + b)' = a' + b'
 */
-std::shared_ptr<Node> Sum::derive() {
-	return newSum(fLeft->derive(), fRight->derive());
+std::shared_ptr<Node> Sum::deriveLocal(const std::shared_ptr<Node> *derivatives) {
+	return newSum(derivatives[0], derivatives[1]);
 }
 
-float Sum::evaluate(float x) {
-	return fLeft->evaluate(x) + fRight->evaluate(x);
+float Sum::evaluateLocal(float x, const float *arguments) {
+	return arguments[0] + arguments[1];
 }
 
-std::shared_ptr<Node> Sum::simplify() {
+void Sum::evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) {
+	const float *left = arguments;
+	const float *right = arguments + kBatchSize;
+	for (size_t i = 0; i < count; i++) {
+		result[i] = left[i] + right[i];
+	}
+}
+
+void Sum::partialsLocal(float x, const float *arguments, float value, float *partials) {
+	partials[0] = 1.0f;
+	partials[1] = 1.0f;
+}
+
+std::shared_ptr<Node> Sum::withChildren(const std::shared_ptr<Node> *children) {
+	return newSum(children[0], children[1]);
+}
+
+std::shared_ptr<Node> Sum::simplifyLocal() {
 	if (isConstant(fRight)) {
 		auto right = toConstant(fRight);
 		if (isConstant(fLeft)) {
 			auto left = toConstant(fLeft);
 			// n + m = p
+			SYMBOLIC_COUNT_RULE("n + m = p");
 			return newConstant(left->fValue + right->fValue);
 		}
 		else {
-			return newSum(fRight->simplify(), fLeft->simplify());
+			SYMBOLIC_COUNT_RULE("x + n = n + x");
+			return newSum(fRight, fLeft);
 		}
 	}
 	if (isConstant(fLeft)) {
 		auto left = toConstant(fLeft);
 		if (left->fValue == 0.0f) {
 			// 0 + n = n
-			return fRight->simplify();
+			SYMBOLIC_COUNT_RULE("0 + n = n");
+			return fRight;
 		}
 	}
 	if (fLeft->equals(fRight)) {
 		// x + x = 2 * x
-		return newProduct(newConstant(2.0f), fLeft->simplify());
+		SYMBOLIC_COUNT_RULE("x + x = 2 * x");
+		return newProduct(newConstant(2.0f), fLeft);
 	}
 	if (isProduct(fLeft) && isProduct(fRight)) {
 		auto left = toProduct(fLeft);
@@ -235,6 +397,7 @@ std::shared_ptr<Node> Sum::simplify() {
 		if (isConstant(left->fLeft) && isConstant(right->fLeft) &&
 			left->fRight->equals(right->fRight)) {
 			// (n * x) + (m * x) = (n + m) * x
+			SYMBOLIC_COUNT_RULE("(n * x) + (m * x) = (n + m) * x");
 			return newProduct(newConstant(toConstant(left->fLeft)->fValue + toConstant(right->fLeft)->fValue), left->fRight);
 		}
 	}
@@ -242,32 +405,83 @@ std::shared_ptr<Node> Sum::simplify() {
 		auto left = toProduct(fLeft);
 		// (n * x) + x = (n + 1) * x
 		if (isConstant(left->fLeft) && left->fRight->equals(fRight)) {
+			SYMBOLIC_COUNT_RULE("(n * x) + x = (n + 1) * x");
 			return newProduct(newConstant(toConstant(left->fLeft)->fValue + 1), fRight);
 		}
 	}
-	if (isVector(fRight)) {
+	if (isProduct(fRight)) {
+		auto right = toProduct(fRight);
+		// x + (n * x) = (n + 1) * x
+		if (isConstant(right->fLeft) && right->fRight->equals(fLeft)) {
+			SYMBOLIC_COUNT_RULE("x + (n * x) = (n + 1) * x");
+			return newProduct(newConstant(toConstant(right->fLeft)->fValue + 1), fLeft);
+		}
+	}
+	auto sine = squaredArgument(fLeft, FunctionKind::Sine);
+	auto cosine = squaredArgument(fRight, FunctionKind::Cosine);
+	if (!sine) {
+		sine = squaredArgument(fRight, FunctionKind::Sine);
+		cosine = squaredArgument(fLeft, FunctionKind::Cosine);
+	}
+	if (sine && cosine && sine->equals(cosine)) {
+		// sin(a) ^ 2 + cos(a) ^ 2 = 1
+		SYMBOLIC_COUNT_RULE("sin(a) ^ 2 + cos(a) ^ 2 = 1");
+		return newConstant(1.0f);
+	}
+	cosine = squaredArgument(fLeft, FunctionKind::Cosine);
+	if (cosine && isProduct(fRight)) {
+		auto right = toProduct(fRight);
+		sine = squaredArgument(right->fRight, FunctionKind::Sine);
+		if (isConstant(right->fLeft) && toConstant(right->fLeft)->fValue == -1.0f &&
+			sine && sine->equals(cosine)) {
+			// cos(a) ^ 2 + (-1 * sin(a) ^ 2) = cos(2 * a)
+			SYMBOLIC_COUNT_RULE("cos(a) ^ 2 + (-1 * sin(a) ^ 2) = cos(2 * a)");
+			return newCosine(newProduct(newConstant(2.0f), cosine));
+		}
+	}
+	if (isNaturalLogarithm(fLeft) && isNaturalLogarithm(fRight)) {
+		auto &a = toNaturalLogarithm(fLeft)->fArgument;
+		auto &b = toNaturalLogarithm(fRight)->fArgument;
+		// ln(a) + ln(b) = ln(a * b), only for positive a and b since a * b may be positive where they are not
+		if (isPositive(a) && isPositive(b)) {
+			SYMBOLIC_COUNT_RULE("ln(a) + ln(b) = ln(a * b)");
+			return newNaturalLogarithm(newProduct(a, b));
+		}
+	}
+	if (isVector(fLeft) && isVector(fRight)) {
 		auto left = toVector(fLeft);
 		auto right = toVector(fRight);
 		if (left->getDimension() == right->getDimension()) {
 			std::vector<std::shared_ptr<Node>> s;
 			s.resize(left->getDimension());
+			SYMBOLIC_COUNT_RULE("[a, b] + [c, d] = [a + c, b + d]");
 			std::transform(left->elements.begin(), left->elements.end(), right->elements.begin(), s.begin(), [](auto &a, auto &b){
-				return newSum(a->simplify(), b->simplify());
+				return newSum(a, b);
 			});
 			return newVector(std::move(s));
 		}
 	}
-	return newSum(fLeft->simplify(), fRight->simplify());
+	else if (isVector(fLeft) || isVector(fRight)) {
+		// A scalar is added to every element
+		auto vector = isVector(fLeft) ? toVector(fLeft) : toVector(fRight);
+		std::vector<std::shared_ptr<Node>> s;
+		s.reserve(vector->getDimension());
+		SYMBOLIC_COUNT_RULE("x + [a, b] = [x + a, x + b]");
+		for (auto &element : vector->elements) {
+			s.push_back(isVector(fLeft) ? newSum(element, fRight) : newSum(fLeft, element));
+		}
+		return newVector(std::move(s));
+	}
+	return shared_from_this();
 }
 
-std::ostream &Sum::out(std::ostream &stream) const {
-	stream << "(" << *fLeft << " + " << *fRight << ")";
-	return stream;
+void Sum::outLocal(std::ostream &stream, size_t position) const {
+	static const char *tokens[] = {"(", " + ", ")"};
+	stream << tokens[position];
 }
 
-bool Sum::equals(const std::shared_ptr<Node> &other) const {
-	auto sum = toSum(other);
-	return sum && sum->fLeft->equals(fLeft) && sum->fRight->equals(fRight);
+bool Sum::equalsLocal(const Node &other) const {
+	return dynamic_cast<const Sum*>(&other) != nullptr;
 }
 
 // Product
@@ -275,24 +489,43 @@ bool Sum::equals(const std::shared_ptr<Node> &other) const {
 	The derivative of a product is
 	(a * b)' = a' * b + a * b'
 */
-std::shared_ptr<Node> Product::derive() {
-	return newSum(newProduct(fLeft->derive(), fRight), newProduct(fLeft, fRight->derive()));
+std::shared_ptr<Node> Product::deriveLocal(const std::shared_ptr<Node> *derivatives) {
+	return newSum(newProduct(derivatives[0], fRight), newProduct(fLeft, derivatives[1]));
+}
+
+float Product::evaluateLocal(float x, const float *arguments) {
+	return arguments[0] * arguments[1];
+}
+
+void Product::evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) {
+	const float *left = arguments;
+	const float *right = arguments + kBatchSize;
+	for (size_t i = 0; i < count; i++) {
+		result[i] = left[i] * right[i];
+	}
+}
+
+void Product::partialsLocal(float x, const float *arguments, float value, float *partials) {
+	partials[0] = arguments[1];
+	partials[1] = arguments[0];
 }
 
-float Product::evaluate(float x) {
-	return fLeft->evaluate(x) * fRight->evaluate(x);
+std::shared_ptr<Node> Product::withChildren(const std::shared_ptr<Node> *children) {
+	return newProduct(children[0], children[1]);
 }
 
-std::shared_ptr<Node> Product::simplify() {
+std::shared_ptr<Node> Product::simplifyLocal() {
 	// Switch so the constant is always left
 	if (isConstant(fRight)) {
 		auto right = toConstant(fRight);
 		if (isConstant(fLeft)) {
 			auto left = toConstant(fLeft);
 			// n * m = p
+			SYMBOLIC_COUNT_RULE("n * m = p");
 			return newConstant(left->fValue * right->fValue);
 		}
 		else {
+			SYMBOLIC_COUNT_RULE("x * n = n * x");
 			return newProduct(fRight, fLeft);
 		}
 	}
@@ -300,23 +533,27 @@ std::shared_ptr<Node> Product::simplify() {
 		auto left = toConstant(fLeft);
 		// 0 * n = 0
 		if (left->fValue == 0.0f) {
+			SYMBOLIC_COUNT_RULE("0 * n = 0");
 			return newConstant(0.0f);
 		}
 		// 1 * n = n
 		else if (left->fValue == 1.0f) {
-			return fRight->simplify();
+			SYMBOLIC_COUNT_RULE("1 * n = n");
+			return fRight;
 		}
 		else if (isProduct(fRight)) {
 			auto product = toProduct(fRight);
 			// n * (m * x) = n*m * x
 			if (isConstant(product->fLeft)) {
 				auto pleft = toConstant(product->fLeft);
+				SYMBOLIC_COUNT_RULE("n * (m * x) = n*m * x");
 				return newProduct(newConstant(left->fValue * pleft->fValue), product->fRight);
 			}
 		}
 	}
 	if (fLeft->equals(fRight)) {
 		// (x * x) = x ^ 2
+		SYMBOLIC_COUNT_RULE("(x * x) = x ^ 2");
 		return newPower(fLeft, newConstant(2.0f));
 	}
 	if (isProduct(fLeft) && isProduct(fRight)) {
@@ -326,6 +563,7 @@ std::shared_ptr<Node> Product::simplify() {
 		if (isConstant(productLeft->fLeft) && isConstant(productRight->fLeft)) {
 			auto left = toConstant(productLeft->fLeft);
 			auto right = toConstant(productRight->fLeft);
+			SYMBOLIC_COUNT_RULE("(n * x) * (m * y) = n*m * (x * y)");
 			return newProduct(newConstant(left->fValue * right->fValue),
 				newProduct(productLeft->fRight, productRight->fRight));
 		}
@@ -334,21 +572,43 @@ std::shared_ptr<Node> Product::simplify() {
 		auto productLeft = toProduct(fLeft);
 		// (n * x) * x = n * (x ^ 2)
 		if (productLeft->fRight->equals(fRight)) {
-			return newProduct(productLeft->fRight, newPower(fRight, newConstant(2.0f)));
+			SYMBOLIC_COUNT_RULE("(n * x) * x = n * (x ^ 2)");
+			return newProduct(productLeft->fLeft, newPower(fRight, newConstant(2.0f)));
+		}
+		// (n * x) * y = n * (x * y), moving constants outwards
+		if (isConstant(productLeft->fLeft)) {
+			SYMBOLIC_COUNT_RULE("(n * x) * y = n * (x * y)");
+			return newProduct(productLeft->fLeft, newProduct(productLeft->fRight, fRight));
 		}
 	}
 	if (isProduct(fRight)) {
 		auto productRight = toProduct(fRight);
 		// x * (n * x) = n * (x ^ 2)
 		if (productRight->fRight->equals(fLeft)) {
+			SYMBOLIC_COUNT_RULE("x * (n * x) = n * (x ^ 2)");
 			return newProduct(productRight->fLeft, newPower(fLeft, newConstant(2.0f)));
 		}
+		// x * (n * y) = n * (x * y), moving constants outwards
+		if (isConstant(productRight->fLeft) && !isConstant(fLeft)) {
+			SYMBOLIC_COUNT_RULE("x * (n * y) = n * (x * y)");
+			return newProduct(productRight->fLeft, newProduct(fLeft, productRight->fRight));
+		}
+	}
+	if ((isSine(fLeft) && isCosine(fRight)) || (isCosine(fLeft) && isSine(fRight))) {
+		auto left = dynamic_cast<Function*>(fLeft.get());
+		auto right = dynamic_cast<Function*>(fRight.get());
+		// sin(a) * cos(a) = 0.5 * sin(2 * a)
+		if (left->fArgument->equals(right->fArgument)) {
+			SYMBOLIC_COUNT_RULE("sin(a) * cos(a) = 0.5 * sin(2 * a)");
+			return newProduct(newConstant(0.5f), newSine(newProduct(newConstant(2.0f), left->fArgument)));
+		}
 	}
 	if (isPower(fLeft) && isPower(fRight)) {
 		auto left = toPower(fLeft);
 		auto right = toPower(fRight);
 		if (left->fBase->equals(right->fBase)) {
 			// (x ^ n) * (x ^ m) = x ^ (n + m)
+			SYMBOLIC_COUNT_RULE("(x ^ n) * (x ^ m) = x ^ (n + m)");
 			return newPower(left->fBase, newSum(left->fExponent, right->fExponent));
 		}
 	}
@@ -356,6 +616,7 @@ std::shared_ptr<Node> Product::simplify() {
 		auto power = toPower(fRight);
 		// x * (x ^ n) = x ^ (n + 1)
 		if (power->fBase->equals(fLeft)) {
+			SYMBOLIC_COUNT_RULE("x * (x ^ n) = x ^ (n + 1)");
 			return newPower(fLeft, newSum(newConstant(1), power->fExponent));
 		}
 	}
@@ -364,28 +625,23 @@ std::shared_ptr<Node> Product::simplify() {
 		if (isConstant(fLeft) || isVariable(fLeft)) {
 			std::vector<std::shared_ptr<Node>> s;
 			s.resize(vector->getDimension());
+			SYMBOLIC_COUNT_RULE("n * [a, b] = [n * a, n * b]");
 			std::transform(vector->elements.begin(), vector->elements.end(), s.begin(), [this](auto &e){
-				return newProduct(fLeft->simplify(), e->simplify());
+				return newProduct(fLeft, e);
 			});
 			return newVector(std::move(s));
 		}
 	}
-	return newProduct(fLeft->simplify(), fRight->simplify());
-}
-
-std::ostream &Product::out(std::ostream &stream) const {
-	stream << "(" << *fLeft << " * " << *fRight << ")";
-	return stream;
+	return shared_from_this();
 }
 
-bool Product::equals(const std::shared_ptr<Node> &other) const {
-	auto product = toProduct(other);
-	return product && product->fLeft->equals(fLeft) && product->fRight->equals(fRight);
+void Product::outLocal(std::ostream &stream, size_t position) const {
+	static const char *tokens[] = {"(", " * ", ")"};
+	stream << tokens[position];
 }
 
-// Function
-std::shared_ptr<Node> Function::derive() {
-	return newProduct(deriveFunction(fArgument), fArgument->derive());
+bool Product::equalsLocal(const Node &other) const {
+	return dynamic_cast<const Product*>(&other) != nullptr;
 }
 
 // Power
@@ -397,137 +653,281 @@ std::shared_ptr<Node> Function::derive() {
 	If b is a constant and e is x this becomes
 	(c ^ x)' = (c ^ e) * (1 * ln(c) + x * 0) = ln(c) * (c ^ x)
 */
-std::shared_ptr<Node> Power::derive() {
+std::shared_ptr<Node> Power::deriveLocal(const std::shared_ptr<Node> *derivatives) {
 	// Specialized for constant exponent since simplification is still lacking
 	if (isConstant(fExponent)) {
 		auto exponent = toConstant(fExponent)->fValue;
-		return newProduct(newProduct(newConstant(exponent), newPower(fBase, newConstant(exponent - 1.0f))), fBase->derive());
+		return newProduct(newProduct(newConstant(exponent), newPower(fBase, newConstant(exponent - 1.0f))), derivatives[0]);
 	}
-	// Specialized for constant base since simplification is still lacking
-	else if (isConstant(fBase)) {
-		auto base = toConstant(fBase)->fValue;
-		return newProduct(shared_from_this(), newSum(newProduct(fExponent->derive(), newNaturalLogarithm(fBase)), newProduct(fExponent, newNaturalLogarithm(fBase)->derive())));
+	// (ln(b))' = b ^ -1 * b'
+	auto logarithm = newNaturalLogarithm(fBase);
+	return newProduct(shared_from_this(), newSum(newProduct(derivatives[1], logarithm), newProduct(fExponent, logarithm->deriveLocal(derivatives))));
+}
+
+float Power::evaluateLocal(float x, const float *arguments) {
+	return powf(arguments[0], arguments[1]);
+}
+
+void Power::evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) {
+	const float *base = arguments;
+	const float *exponent = arguments + kBatchSize;
+	for (size_t i = 0; i < count; i++) {
+		result[i] = powf(base[i], exponent[i]);
 	}
-	return newProduct(shared_from_this(), newSum(newProduct(fExponent->derive(), newNaturalLogarithm(fBase)), newProduct(fExponent, newNaturalLogarithm(fBase)->derive())));
 }
 
-float Power::evaluate(float x) {
-	return powf(fBase->evaluate(x), fExponent->evaluate(x));
+// b ^ e with respect to b and e, e * b ^ (e - 1) and b ^ e * ln(b)
+void Power::partialsLocal(float x, const float *arguments, float value, float *partials) {
+	partials[0] = arguments[1] * powf(arguments[0], arguments[1] - 1.0f);
+	partials[1] = value * logf(arguments[0]);
 }
 
-std::shared_ptr<Node> Power::simplify() {
+std::shared_ptr<Node> Power::withChildren(const std::shared_ptr<Node> *children) {
+	return newPower(children[0], children[1]);
+}
+
+std::shared_ptr<Node> Power::simplifyLocal() {
 	if (isConstant(fExponent)) {
 		auto exponent = toConstant(fExponent);
 		if (exponent->fValue == 0) {
+			SYMBOLIC_COUNT_RULE("x ^ 0 = 1");
 			return newConstant(1);
 		}
 		else if (exponent->fValue == 1) {
-			return fBase->simplify();
+			SYMBOLIC_COUNT_RULE("x ^ 1 = x");
+			return fBase;
 		}
 	}
 	if (isPower(fBase)) {
 		auto power = toPower(fBase);
+		SYMBOLIC_COUNT_RULE("(x ^ n) ^ m = x ^ (n * m)");
 		return newPower(power->fBase, newProduct(power->fExponent, fExponent));
 	}
-	return newPower(fBase->simplify(), fExponent->simplify());
-	//return shared_from_this();
+	return shared_from_this();
 }
 
-std::ostream &Power::out(std::ostream &stream) const {
-	/*if (isConstant(fExponent)) {
-		float exponent = dynamic_cast<Constant*>(fExponent.get())->fValue;
-		float absExponent = std::abs(exponent);
-		if (exponent < 0) {
-			stream << "1/(";
-		}
-		if (absExponent == 0.5f) {
-			stream << "√(" << *fBase << ")";
-		}
-		else if (absExponent == 1.0f) {
-			stream << *fBase;
+// Fully parenthesized, see Printer for the √, ² and ³ forms
+void Power::outLocal(std::ostream &stream, size_t position) const {
+	static const char *tokens[] = {"(", " ^ ", ")"};
+	stream << tokens[position];
+}
+
+bool Power::equalsLocal(const Node &other) const {
+	return dynamic_cast<const Power*>(&other) != nullptr;
+}
+
+// Function
+namespace {
+
+template <float (*f)(float)>
+void evaluateBatch(const float *arguments, float *result, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		result[i] = f(arguments[i]);
+	}
+}
+
+// n when the argument of function is -n * a, 0 otherwise
+float negatedFactor(const Function &function) {
+	if (isProduct(function.fArgument)) {
+		auto product = toProduct(function.fArgument);
+		if (isConstant(product->fLeft) && toConstant(product->fLeft)->fValue < 0.0f) {
+			return -toConstant(product->fLeft)->fValue;
 		}
-		else if (absExponent == 2.0f) {
-			stream << "(" << *fBase << ")²";
+	}
+	return 0.0f;
+}
+
+// f(-n * a) = f(n * a)
+std::shared_ptr<Node> simplifyEven(const Function &function) {
+	float factor = negatedFactor(function);
+	if (factor == 0.0f) {
+		return nullptr;
+	}
+	SYMBOLIC_COUNT_RULE("f(-n * a) = f(n * a)");
+	return newFunction(function.fKind, newProduct(newConstant(factor), toProduct(function.fArgument)->fRight));
+}
+
+// f(-n * a) = -1 * f(n * a)
+std::shared_ptr<Node> simplifyOdd(const Function &function) {
+	float factor = negatedFactor(function);
+	if (factor == 0.0f) {
+		return nullptr;
+	}
+	SYMBOLIC_COUNT_RULE("f(-n * a) = -1 * f(n * a)");
+	return newProduct(newConstant(-1.0f), newFunction(function.fKind, newProduct(newConstant(factor), toProduct(function.fArgument)->fRight)));
+}
+
+/*
+	ln(a ^ b) = b * ln(a) keeps its value for negative a only when b is a
+	constant other than an even integer, the power being negative or NaN
+	wherever a is. Even powers of a negative base are positive, so those
+	take the logarithm of abs(a).
+*/
+std::shared_ptr<Node> simplifyNaturalLogarithm(const Function &function) {
+	auto &argument = function.fArgument;
+	if (isPower(argument)) {
+		auto power = toPower(argument);
+		float exponent = isConstant(power->fExponent) ? toConstant(power->fExponent)->fValue : 0.0f;
+		if (isPositive(power->fBase) || (exponent != 0.0f && !isEvenInteger(exponent))) {
+			SYMBOLIC_COUNT_RULE("ln(a ^ b) = b * ln(a)");
+			return newProduct(power->fExponent, newNaturalLogarithm(power->fBase));
 		}
-		else if (absExponent == 3.0f) {
-			stream << "(" << *fBase << ")³";
+		if (exponent != 0.0f) {
+			SYMBOLIC_COUNT_RULE("ln(a ^ 2n) = 2n * ln(abs(a))");
+			return newProduct(power->fExponent, newNaturalLogarithm(newFunction(FunctionKind::AbsoluteValue, power->fBase)));
 		}
-		if (exponent < 0) {
-			stream << ")";
+	}
+	if (isProduct(argument)) {
+		auto product = toProduct(argument);
+		// ln(n * a) = ln(n) + ln(a), which folds into n' + ln(a)
+		if (isConstant(product->fLeft) && toConstant(product->fLeft)->fValue > 0.0f) {
+			SYMBOLIC_COUNT_RULE("ln(n * a) = ln(n) + ln(a)");
+			return newSum(newNaturalLogarithm(product->fLeft), newNaturalLogarithm(product->fRight));
 		}
 	}
-	else {*/
-		stream << "(" << *fBase << " ^ " << *fExponent << ")";
-	//}
-	return stream;
+	if (isExponential(argument)) {
+		SYMBOLIC_COUNT_RULE("ln(exp(a)) = a");
+		return toExponential(argument)->fArgument;
+	}
+	return nullptr;
 }
 
-bool Power::equals(const std::shared_ptr<Node> &other) const {
-	auto power = toPower(other);
-	return power && power->fBase->equals(fBase) && power->fExponent->equals(fExponent);
+std::shared_ptr<Node> simplifyAbsoluteValue(const Function &function) {
+	if (toFunction(function.fArgument, FunctionKind::AbsoluteValue)) {
+		SYMBOLIC_COUNT_RULE("abs(abs(a)) = abs(a)");
+		return function.fArgument;
+	}
+	return simplifyEven(function);
+}
+
+/*
+	Rows in FunctionKind order. Derivatives are in terms of u, the argument:
+	ln(u)' = u ^ -1, tan(u)' = cos(u) ^ -2, abs(u)' = sign(u) and
+	tanh(u)' = 1 - tanh(u) ^ 2.
+*/
+constexpr FunctionInfo kFunctions[] = {
+	{"NaturalLogarithm", "ln", "\\ln", logf, evaluateBatch<logf>, logarithm, [](float u, float v) { return 1.0f / u; },
+		[](const std::shared_ptr<Node> &u) -> std::shared_ptr<Node> { return newPower(u, newConstant(-1.0f)); },
+		simplifyNaturalLogarithm},
+	{"Cosine", "cos", "\\cos", cosf, evaluateBatch<cosf>, cosine, [](float u, float v) { return -sinf(u); },
+		[](const std::shared_ptr<Node> &u) -> std::shared_ptr<Node> { return newProduct(newConstant(-1.0f), newSine(u)); },
+		simplifyEven},
+	{"Sine", "sin", "\\sin", sinf, evaluateBatch<sinf>, sine, [](float u, float v) { return cosf(u); },
+		[](const std::shared_ptr<Node> &u) -> std::shared_ptr<Node> { return newCosine(u); },
+		simplifyOdd},
+	{"Exponential", "exp", "\\exp", expf, evaluateBatch<expf>, exponential, [](float u, float v) { return v; },
+		[](const std::shared_ptr<Node> &u) -> std::shared_ptr<Node> { return newExponential(u); },
+		nullptr},
+	{"Tangent", "tan", "\\tan", tanf, evaluateBatch<tanf>, tangent, [](float u, float v) { return 1.0f + v * v; },
+		[](const std::shared_ptr<Node> &u) -> std::shared_ptr<Node> { return newPower(newCosine(u), newConstant(-2.0f)); },
+		simplifyOdd},
+	{"AbsoluteValue", "abs", "\\operatorname{abs}", fabsf, evaluateBatch<fabsf>, absolute, [](float u, float v) { return signf(u); },
+		[](const std::shared_ptr<Node> &u) -> std::shared_ptr<Node> { return newFunction(FunctionKind::Sign, u); },
+		simplifyAbsoluteValue},
+	{"HyperbolicTangent", "tanh", "\\tanh", tanhf, evaluateBatch<tanhf>, hyperbolicTangent, [](float u, float v) { return 1.0f - v * v; },
+		[](const std::shared_ptr<Node> &u) -> std::shared_ptr<Node> {
+			return newSum(newConstant(1.0f), newProduct(newConstant(-1.0f), newPower(newFunction(FunctionKind::HyperbolicTangent, u), newConstant(2.0f))));
+		},
+		simplifyOdd},
+	{"Sign", "sign", "\\operatorname{sign}", signf, evaluateBatch<signf>, sign, [](float u, float v) { return 0.0f; },
+		[](const std::shared_ptr<Node> &u) -> std::shared_ptr<Node> { return newConstant(0.0f); },
+		simplifyOdd}
+};
+
+static_assert(sizeof(kFunctions) / sizeof(kFunctions[0]) == kFunctionKindCount, "One row per FunctionKind");
+
+constexpr bool evaluatesFunctionValues() {
+	for (size_t i = 0; i < kFunctionKindCount; i++) {
+		if (kFunctions[i].evaluate != kFunctionValues[i]) {
+			return false;
+		}
+	}
+	return true;
 }
 
-std::shared_ptr<Node> NaturalLogarithm::deriveFunction(const std::shared_ptr<Node> &argument) {
-	return newPower(argument, newConstant(-1.0f));
+static_assert(evaluatesFunctionValues(), "The evaluate column is kFunctionValues");
+
 }
 
-float NaturalLogarithm::evaluate(float x) {
-	return log(x);
+const FunctionInfo &functionInfo(FunctionKind kind) {
+	return kFunctions[static_cast<size_t>(kind)];
 }
 
-std::shared_ptr<Node> NaturalLogarithm::simplify() {
-	return shared_from_this();
+/*
+	Chain rule, (f(u))' = f'(u) * u'
+*/
+std::shared_ptr<Node> Function::deriveLocal(const std::shared_ptr<Node> *derivatives) {
+	return newProduct(functionInfo(fKind).derive(fArgument), derivatives[0]);
 }
 
-std::ostream &NaturalLogarithm::out(std::ostream &stream) const {
-	stream << "ln(" << *fArgument << ")";
-	return stream;
+float Function::evaluateLocal(float x, const float *arguments) {
+	return functionInfo(fKind).evaluate(arguments[0]);
 }
 
-bool NaturalLogarithm::equals(const std::shared_ptr<Node> &other) const {
-	return equalsHelper<NaturalLogarithm>(other);
+void Function::evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) {
+	functionInfo(fKind).evaluateBatch(arguments, result, count);
 }
 
-// Cosine
-std::shared_ptr<Node> Cosine::deriveFunction(const std::shared_ptr<Node> &argument) {
-	return newProduct(newConstant(-1.0f), newSine(argument));
+void Function::partialsLocal(float x, const float *arguments, float value, float *partials) {
+	partials[0] = functionInfo(fKind).slope(arguments[0], value);
 }
 
-float Cosine::evaluate(float x) {
-	return cosf(fArgument->evaluate(x));
+std::shared_ptr<Node> Function::withChildren(const std::shared_ptr<Node> *children) {
+	return newFunction(fKind, children[0]);
 }
 
-std::shared_ptr<Node> Cosine::simplify() {
+std::shared_ptr<Node> Function::simplifyLocal() {
+	auto &info = functionInfo(fKind);
+	if (isConstant(fArgument)) {
+		// f(n) = m
+		float value = info.evaluate(toConstant(fArgument)->fValue);
+		if (std::isfinite(value)) {
+			SYMBOLIC_COUNT_RULE("f(n) = m");
+			return newConstant(value);
+		}
+	}
+	if (info.simplify) {
+		if (auto simplified = info.simplify(*this)) {
+			return simplified;
+		}
+	}
 	return shared_from_this();
 }
 
-std::ostream &Cosine::out(std::ostream &stream) const {
-	stream << "cos(" << *fArgument << ")";
-	return stream;
+void Function::outLocal(std::ostream &stream, size_t position) const {
+	if (position) {
+		stream << ")";
+	}
+	else {
+		stream << functionInfo(fKind).symbol << "(";
+	}
 }
 
-bool Cosine::equals(const std::shared_ptr<Node> &other) const {
-	return equalsHelper<Cosine>(other);
+bool Function::equalsLocal(const Node &other) const {
+	auto function = dynamic_cast<const Function*>(&other);
+	return function && function->fKind == fKind;
 }
 
-// Sine
-std::shared_ptr<Node> Sine::deriveFunction(const std::shared_ptr<Node> &argument) {
-	return newCosine(argument);
+// Integral
+/*
+	The derivative of an integral is its integrand
+*/
+std::shared_ptr<Node> Integral::deriveLocal(const std::shared_ptr<Node> *derivatives) {
+	return fIntegrand;
 }
 
-float Sine::evaluate(float x) {
-	return sinf(fArgument->evaluate(x));
+float Integral::evaluateLocal(float x, const float *arguments) {
+	return integrate(NodeRef(fIntegrand), 0.0f, x);
 }
 
-std::shared_ptr<Node> Sine::simplify() {
-	return shared_from_this();
+std::shared_ptr<Node> Integral::withChildren(const std::shared_ptr<Node> *children) {
+	return newIntegral(children[0]);
 }
 
-std::ostream &Sine::out(std::ostream &stream) const {
-	stream << "sin(" << *fArgument << ")";
-	return stream;
+void Integral::outLocal(std::ostream &stream, size_t position) const {
+	stream << (position ? ")dx" : "∫(");
 }
 
-bool Sine::equals(const std::shared_ptr<Node> &other) const {
-	return equalsHelper<Sine>(other);
-}
\ No newline at end of file
+bool Integral::equalsLocal(const Node &other) const {
+	return dynamic_cast<const Integral*>(&other) != nullptr;
+}
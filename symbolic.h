@@ -1,67 +1,477 @@
+#pragma once
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <math.h>
 
-class Node {
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "instrumentation.h"
+
+// Closed range of values, used to bound an expression over a range of x
+struct Interval {
+	float lower;
+	float upper;
+
+	bool contains(float value) const { return lower <= value && value <= upper; }
+	float width() const { return upper - lower; }
+	float middle() const { return 0.5f * (lower + upper); }
+};
+
+// Maximum number of points a single Node::evaluateBatch() call handles
+constexpr size_t kBatchSize = 64;
+
+// Output formats of Printer
+enum class Format {
+	Infix,			// x ^ 2 + 1 printed as x² + 1
+	LaTeX,			// x^{2} + 1
+	SExpression		// (+ (^ x 2) 1)
+};
+
+// How a node prints, see Printer. Children at positions from printed on are not printed.
+struct PrintForm {
+	const char *prefix;
+	const char *infix;
+	const char *suffix;
+	int precedence;
+	int childPrecedence[2];	// Minimum precedence children print without parentheses
+	size_t printed;
+};
+
+/*
+	Operations on a tree are explicit stack traversals that visit the
+	children first and then combine their results with the *Local() method
+	of the node, so arbitrarily deep trees fit on any thread stack.
+*/
+class Node : public std::enable_shared_from_this<Node> {
 public:
-	virtual std::shared_ptr<Node> derive() = 0;
-	virtual float evaluate(float x) = 0;
-	virtual std::shared_ptr<Node> simplify() = 0;
-	virtual std::ostream &out(std::ostream &stream) const = 0;
-	virtual bool equals(const std::shared_ptr<Node> &other) const {return false;}
+	virtual ~Node() {}
+
+	std::shared_ptr<Node> derive();
+	float evaluate(float x);
+	// Evaluates count <= kBatchSize points
+	void evaluateBatch(const float *x, float *result, size_t count);
+	// Guaranteed bounds of the expression over x, the whole real line when unknown
+	Interval evaluateInterval(const Interval &x);
+	// One bottom-up pass of the local rules over the whole tree
+	std::shared_ptr<Node> simplify();
+	std::ostream &out(std::ostream &stream) const;
+	bool equals(const std::shared_ptr<Node> &other) const;
+
+	size_t getChildCount() const { return fChildCount; }
+	virtual const std::shared_ptr<Node> &getChild(size_t index) const;
+
+	// Derivative given the derivatives of the children
+	virtual std::shared_ptr<Node> deriveLocal(const std::shared_ptr<Node> *derivatives) = 0;
+	// Value given the values of the children
+	virtual float evaluateLocal(float x, const float *arguments) = 0;
+	/*
+		Values of count points given those of the children, child i at
+		arguments + i * kBatchSize. The result may alias the first child,
+		so write simple element wise loops, which also vectorize.
+	*/
+	virtual void evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count);
+	virtual Interval evaluateIntervalLocal(const Interval &x, const Interval *arguments);
+	// Partial derivative of the value with respect to every child, NaN when unknown
+	virtual void partialsLocal(float x, const float *arguments, float value, float *partials);
+	// The same node with other children
+	virtual std::shared_ptr<Node> withChildren(const std::shared_ptr<Node> *children) { return shared_from_this(); }
+	// Applies the first matching rule, the children being simplified already
+	virtual std::shared_ptr<Node> simplifyLocal() { return shared_from_this(); }
+	// Writes what comes before child position, or after the last child
+	virtual void outLocal(std::ostream &stream, size_t position) const = 0;
+	// Text around the children in format, kept in static tables
+	virtual const PrintForm &formLocal(Format format) const;
+	// Text of a leaf between the prefix and suffix of its form, its value or name
+	virtual void printLocal(std::string &text) const {}
+	// Compares type and own data, the children are compared by equals()
+	virtual bool equalsLocal(const Node &other) const = 0;
+
+	// Number of nodes in the tree, shared subexpressions counted once per use
+	size_t size() const { return fSize; }
+	// Number of nodes on the longest path down to a leaf
+	size_t depth() const { return fDepth; }
+
+protected:
+	// Called by constructors for every child, keeping size and depth cached
+	void addChild(const std::shared_ptr<Node> &child) {
+		fSize = fSize + child->fSize < fSize ? SIZE_MAX : fSize + child->fSize;
+		fDepth = child->fDepth + 1 > fDepth ? child->fDepth + 1 : fDepth;
+		fChildCount++;
+	}
+
+	/*
+		Called by destructors for every child. Destroying the last reference
+		to a child is deferred to a loop instead of recursing.
+	*/
+	static void release(std::shared_ptr<Node> &child);
+
+	size_t fSize{1};
+	size_t fDepth{1};
+	size_t fChildCount{0};
 };
 
 inline std::ostream &operator<< (std::ostream &stream, Node &node) {
 	return node.out(stream);
 }
 
+// Budgets for equality saturation, see NodeRef::saturate()
+struct SaturationLimits {
+	size_t maxNodes{10000};
+	size_t maxIterations{32};
+	float maxMilliseconds{50.0f};
+};
+
+/*
+	Limits on the work done by NodeRef::derive(const Budget&) and
+	NodeRef::simplify(const Budget&), zero meaning unlimited. Nodes counts
+	every node created, depth limits the depth of any node created.
+*/
+struct Budget {
+	size_t maxNodes{0};
+	size_t maxDepth{0};
+	float maxMilliseconds{0.0f};
+};
+
+class BudgetExceeded : public std::runtime_error {
+public:
+	BudgetExceeded(const char *what) :
+	std::runtime_error(what) {}
+};
+
 class NodeRef {
 public:
-	NodeRef(const std::shared_ptr<Node> &node) :
-	fRef(node) {}
+	NodeRef(std::shared_ptr<Node> node) :
+	fRef(std::move(node)) {}
 
 	NodeRef derive() {
+		SYMBOLIC_TRACE("derive");
 		return NodeRef(fRef->derive());
 	}
 
+	// Throws BudgetExceeded when the budget runs out
+	NodeRef derive(const Budget &budget);
+
 	float evaluate(float x) {
 		return fRef->evaluate(x);
 	}
 
+	void evaluate(const float *x, float *result, size_t count) {
+		for (size_t i = 0; i < count; i += kBatchSize) {
+			fRef->evaluateBatch(x + i, result + i, count - i < kBatchSize ? count - i : kBatchSize);
+		}
+	}
+
+	Interval evaluate(const Interval &x) {
+		return fRef->evaluateInterval(x);
+	}
+
 	NodeRef simplifyStep() {
 		return NodeRef(fRef->simplify());
 	}
 
 	NodeRef simplify() {
+		SYMBOLIC_TRACE("simplify");
 		auto prev = fRef;
-		auto simplified = prev->simplify();
+		auto simplified = simplifyPass(prev);
 		while (!simplified->equals(prev)) {
 			prev = simplified;
-			simplified = simplified->simplify();
+			simplified = simplifyPass(prev);
 		}
 		return NodeRef(simplified);
 	}
 
-	friend NodeRef operator+(const NodeRef &left, const NodeRef &right);
-	friend NodeRef operator-(const NodeRef &left, const NodeRef &right);
-	friend NodeRef operator*(float left, const NodeRef &right);
-	friend NodeRef operator*(const NodeRef &left, const NodeRef &right);
-	friend NodeRef operator/(float left, const NodeRef &right);
-	friend NodeRef operator/(const NodeRef &left, const NodeRef &right);
-	friend NodeRef operator^(const NodeRef &base, float exponent);
-	friend NodeRef operator^(float base, const NodeRef &exponent);
-	friend NodeRef operator^(const NodeRef &base, const NodeRef &exponent);
+	// Returns the result of the last complete pass when the budget runs out
+	NodeRef simplify(const Budget &budget);
+
+	size_t size() const {
+		return fRef->size();
+	}
+
+	size_t depth() const {
+		return fRef->depth();
+	}
+
+	// Number of elements of a vector, 1 for a scalar
+	size_t dimension() const;
+
+	/*
+		Evaluates every component at count points, component i being
+		written to result + i * count. Flattens the expression on every
+		call, see ComponentEvaluator for repeated evaluations.
+	*/
+	void evaluateComponents(const float *x, float *result, size_t count);
+
+	// Antiderivative with zero integration constant, see containsIntegral()
+	NodeRef integrate();
+
+	// Applies all identities non-destructively in an e-graph until saturation
+	// or until a limit is hit, then extracts the cheapest expression to evaluate
+	NodeRef saturate(const SaturationLimits &limits = SaturationLimits());
+
+	friend NodeRef operator+(NodeRef left, NodeRef right);
+	friend NodeRef operator-(NodeRef left, NodeRef right);
+	friend NodeRef operator*(float left, NodeRef right);
+	friend NodeRef operator*(NodeRef left, NodeRef right);
+	friend NodeRef operator/(float left, NodeRef right);
+	friend NodeRef operator/(NodeRef left, NodeRef right);
+	friend NodeRef operator^(NodeRef base, float exponent);
+	friend NodeRef operator^(float base, NodeRef exponent);
+	friend NodeRef operator^(NodeRef base, NodeRef exponent);
 	friend std::ostream &operator<< (std::ostream &stream, const NodeRef &node);
 	friend bool operator==(const NodeRef &left, const NodeRef &right);
 
 	std::shared_ptr<Node> fRef;
+
+private:
+	// One simplify() pass, recorded when instrumented
+	static std::shared_ptr<Node> simplifyPass(const std::shared_ptr<Node> &node) {
+		SYMBOLIC_TRACE("simplify pass");
+		auto simplified = node->simplify();
+		SYMBOLIC_RECORD_PASS(node, simplified);
+		return simplified;
+	}
 };
 
+// Functions of one argument, see the function table in symbolic_internal.h
+enum class FunctionKind : uint8_t {
+	NaturalLogarithm,
+	Cosine,
+	Sine,
+	Exponential,
+	Tangent,
+	AbsoluteValue,
+	HyperbolicTangent,
+	Sign		// -1, 0 or 1, the derivative of abs
+};
+
+const size_t kFunctionKindCount = 8;
+
+inline float signf(float value) {
+	return value > 0.0f ? 1.0f : value < 0.0f ? -1.0f : 0.0f;
+}
+
+/*
+	f(u) for every FunctionKind, the evaluate column of the function table.
+	A constant, so static expressions call the functions directly and the
+	compiler can inline them and share equal calls.
+*/
+constexpr float (*kFunctionValues[kFunctionKindCount])(float) = {logf, cosf, sinf, expf, tanf, fabsf, tanhf, signf};
+
+// f(argument) for any kind, ln() to tanh() being shortcuts for the common ones
+NodeRef function(FunctionKind kind, NodeRef argument);
+
 NodeRef constant(float value);
 NodeRef variable();
 NodeRef vec2(const NodeRef&, const NodeRef&);
-NodeRef sqrt(const NodeRef &argument);
-NodeRef ln(const NodeRef &argument);
-NodeRef cos(const NodeRef &argument);
-NodeRef sin(const NodeRef &argument);
-NodeRef dot(const NodeRef &left, const NodeRef &right);
\ No newline at end of file
+NodeRef vec(const std::vector<NodeRef> &elements);
+NodeRef sqrt(NodeRef argument);
+NodeRef ln(NodeRef argument);
+NodeRef cos(NodeRef argument);
+NodeRef sin(NodeRef argument);
+NodeRef exp(NodeRef argument);
+NodeRef tan(NodeRef argument);
+NodeRef abs(NodeRef argument);
+NodeRef tanh(NodeRef argument);
+NodeRef dot(const NodeRef &left, const NodeRef &right);
+
+// ((terms[0] + terms[1]) + terms[2]) ..., 0 when empty
+NodeRef sum(std::vector<NodeRef> terms);
+// ((factors[0] * factors[1]) * factors[2]) ..., 1 when empty
+NodeRef product(std::vector<NodeRef> factors);
+// coefficients[0] + coefficients[1] * x + coefficients[2] * x ^ 2 ...
+NodeRef polynomial(const std::vector<float> &coefficients, const NodeRef &x);
+
+// A constant that can be changed after building the expression, see IncrementalEvaluator
+NodeRef parameter(const std::string &name, float value);
+// Throws std::invalid_argument when parameter was not made by parameter()
+void setParameter(const NodeRef &parameter, float value);
+
+/*
+	Evaluates an expression repeatedly, caching the value of every node.
+	After a parameter changes only the nodes on the paths from it to the
+	root are recomputed, after x changes only the nodes depending on x.
+	Shared subexpressions are evaluated once. The expression must not be
+	modified otherwise while the evaluator is in use.
+*/
+class IncrementalEvaluator {
+public:
+	// Throws std::invalid_argument when node is a vector
+	IncrementalEvaluator(const NodeRef &node);
+
+	float evaluate(float x);
+	// Nodes recomputed by the last evaluate()
+	size_t getRecomputed() const { return fRecomputed; }
+
+private:
+	struct Entry {
+		Node *node;
+		size_t firstArgument;	// Into fArguments
+		size_t firstParent;		// Into fParents
+		size_t parentCount;
+		bool dirty;
+	};
+
+	void markDirty(size_t index);
+
+	NodeRef fRoot;
+	std::vector<Entry> fEntries;		// Post-order, children before parents
+	std::vector<size_t> fArguments;		// Child indices per entry
+	std::vector<size_t> fParents;		// Parent indices per entry
+	std::vector<float> fValues;
+	std::vector<float> fParameterValues;	// Per fParameters entry, as last evaluated
+	std::vector<size_t> fParameters;
+	std::vector<size_t> fSources;		// Entries evaluating x directly
+	std::vector<size_t> fDirty;
+	std::vector<float> fScratch;
+	float fX{0.0f};
+	bool fEvaluated{false};
+	size_t fRecomputed{0};
+};
+
+/*
+	Products with the Jacobian of an expression with respect to the given
+	parameters at a point x, without building the Jacobian. The components
+	of a vector expression are its elements. Like IncrementalEvaluator it
+	flattens the expression once, shared subexpressions becoming one entry,
+	and only follows nodes that depend on a parameter.
+*/
+class JacobianEvaluator {
+public:
+	JacobianEvaluator(const NodeRef &node, const std::vector<NodeRef> &parameters);
+
+	size_t getDimension() const { return fComponents.size(); }
+	// One value per component
+	void evaluate(float x, float *result);
+	// Forward mode J * tangent, one tangent value per parameter and one result per component
+	void jvp(float x, const float *tangent, float *result);
+	// Reverse mode cotangent * J, one cotangent value per component and one result per parameter
+	void vjp(float x, const float *cotangent, float *result);
+
+private:
+	struct Entry {
+		Node *node;
+		size_t firstArgument;	// Into fArguments and fPartials
+		bool dependent;			// On any of the parameters
+	};
+
+	void evaluateEntries(float x);
+
+	NodeRef fRoot;
+	std::vector<Entry> fEntries;		// Post-order, children before parents
+	std::vector<size_t> fArguments;		// Child indices per entry
+	std::vector<float> fValues;
+	std::vector<float> fPartials;		// Per child, see Node::partialsLocal()
+	std::vector<float> fDerivatives;	// Tangents or adjoints per entry
+	std::vector<size_t> fComponents;
+	std::vector<size_t> fParameters;	// Entry per parameter, SIZE_MAX when absent
+	std::vector<float> fScratch;
+};
+
+/*
+	Evaluates the components of an expression at many points, like
+	NodeRef::evaluateComponents(). The expression is flattened once, shared
+	subexpressions becoming one entry evaluated once per block of points,
+	and the buffers are kept between calls.
+*/
+class ComponentEvaluator {
+public:
+	ComponentEvaluator(const NodeRef &node);
+
+	size_t getDimension() const { return fComponents.size(); }
+	// Component i of the count points is written to result + i * count
+	void evaluate(const float *x, float *result, size_t count);
+
+private:
+	NodeRef fRoot;
+	std::vector<Node*> fEntries;		// Post-order, children before parents
+	std::vector<size_t> fArguments;		// Child indices per entry
+	std::vector<size_t> fComponents;
+	std::vector<float> fValues;			// A block of kBatchSize values per entry
+	std::vector<float> fScratch;		// Blocks of the children of one entry
+};
+
+/*
+	Prints expressions with only the parentheses the precedence of the
+	operators requires. The buffer and the traversal stack are kept between
+	calls, so printing does not allocate once they have grown large enough.
+	NodeRef's operator<< keeps printing every parenthesis.
+*/
+class Printer {
+public:
+	Printer(Format format = Format::Infix) :
+	fFormat(format) {}
+
+	// Valid until the next call
+	const std::string &print(const NodeRef &node);
+
+private:
+	struct Frame {
+		const Node *node;
+		const PrintForm *form;
+		size_t position;
+		bool parenthesized;
+	};
+
+	Format fFormat;
+	std::string fBuffer;
+	std::vector<Frame> fFrames;
+};
+
+// Weight of a math library call relative to an addition or multiplication
+constexpr float kCallCost = 16.0f;
+
+// Cost of a single evaluate() call, counting arithmetic operations and
+// calls into the math library (powf, logf, cosf, ...) separately
+struct EvaluationCost {
+	size_t flops{0};
+	size_t calls{0};
+
+	float total() const { return flops + kCallCost * calls; }
+};
+
+EvaluationCost evaluationCost(const NodeRef &node);
+
+// Ranges that may contain a root, no wider than tolerance, found by interval bisection
+std::vector<Interval> findRoots(const NodeRef &node, const Interval &domain, float tolerance = 1e-5f);
+
+struct Extremum {
+	float x;
+	float value;
+	Interval bound;	// Guaranteed to contain the true extremum
+};
+
+// Global extrema by branch and bound on interval evaluation
+Extremum findMinimum(const NodeRef &node, const Interval &domain, float tolerance = 1e-5f);
+Extremum findMaximum(const NodeRef &node, const Interval &domain, float tolerance = 1e-5f);
+
+// Root finding, see solve()
+enum class SolverMethod {
+	Newton,		// Converges quadratically, uses the first derivative
+	Halley		// Converges cubically, also uses the second derivative
+};
+
+struct SolverOptions {
+	SolverMethod method{SolverMethod::Newton};
+	size_t maxIterations{50};
+	float tolerance{1e-6f};	// On the last step, relative to max(1, |x|)
+};
+
+struct Solution {
+	float root;
+	float value;		// Of the expression at root
+	size_t iterations;
+	bool converged;		// False when out of iterations or the step was not finite
+};
+
+// Iterates from every starting point at once, points leaving as they converge
+std::vector<Solution> solve(const NodeRef &node, const std::vector<float> &starts, const SolverOptions &options = SolverOptions());
+
+// True when an integral could not be found in closed form
+bool containsIntegral(const NodeRef &node);
+
+// Definite integral over [a, b] using adaptive Gauss-Kronrod quadrature
+float integrate(const NodeRef &node, float a, float b, float tolerance = 1e-5f);
+// Integrates many intervals in parallel
+std::vector<float> integrate(const NodeRef &node, const std::vector<std::pair<float, float>> &intervals, float tolerance = 1e-5f);
\ No newline at end of file
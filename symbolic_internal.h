@@ -1,22 +1,70 @@
+#pragma once
+#include <atomic>
+#include <string>
 #include <vector>
 
+// Budgets
+/*
+	The budget of the innermost NodeRef::derive(const Budget&) or
+	NodeRef::simplify(const Budget&) running on this thread. Every factory
+	below charges it for the node it creates.
+*/
+class BudgetScope {
+public:
+	BudgetScope(const Budget &budget);
+	~BudgetScope();
+
+	void charge(const Node &node);
+
+	Budget fBudget;
+	size_t fNodes{0};
+	double fDeadline{0.0};
+	bool fExhausted{false};
+	BudgetScope *fPrevious{nullptr};
+};
+
+extern thread_local BudgetScope *gBudgetScope;
+
+template <typename T>
+inline std::shared_ptr<T> charged(std::shared_ptr<T> &&node) {
+	for (auto scope = gBudgetScope; scope; scope = scope->fPrevious) {
+		scope->charge(*node);
+	}
+	return std::move(node);
+}
+
 // Scalars, vectors, matrices
-class Constant : public Node, public std::enable_shared_from_this<Constant> {
+class Constant : public Node {
 public:
 	Constant(float value) :
 	fValue(value) {}
 
- 	std::shared_ptr<Node> derive() override;
-	float evaluate(float x) override;
-	std::shared_ptr<Node> simplify() override;
-	std::ostream &out(std::ostream &stream) const override;
-	bool equals(const std::shared_ptr<Node> &other) const override;
-
-	float fValue{0.0f};
+	std::shared_ptr<Node> deriveLocal(const std::shared_ptr<Node> *derivatives) override;
+	float evaluateLocal(float x, const float *arguments) override;
+	void evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) override;
+	Interval evaluateIntervalLocal(const Interval &x, const Interval *arguments) override;
+	void outLocal(std::ostream &stream, size_t position) const override;
+	const PrintForm &formLocal(Format format) const override;
+	void printLocal(std::string &text) const override;
+	bool equalsLocal(const Node &other) const override;
+
+	// Const because cachedConstant() shares one node between all users of a value
+	const float fValue;
 };
 
+/*
+	The same node for every 0, 1, -1 and 2 created on a thread, rules create
+	these all the time. Constants never change, so sharing them is safe.
+*/
+std::shared_ptr<Constant> cachedConstant(float value);
+
 inline std::shared_ptr<Constant> newConstant(float value) {
-	return std::make_shared<Constant>(value);
+	// -0 prints differently and is not cached
+	if ((value == 0.0f && !std::signbit(value)) || value == 1.0f || value == -1.0f || value == 2.0f) {
+		return cachedConstant(value);
+	}
+	SYMBOLIC_COUNT_ALLOCATION("Constant");
+	return charged(std::make_shared<Constant>(value));
 }
 
 inline Constant *toConstant(const std::shared_ptr<Node> &node) {
@@ -27,19 +75,22 @@ inline bool isConstant(const std::shared_ptr<Node> &node) {
 	return toConstant(node) != nullptr;
 }
 
-class Variable : public Node, public std::enable_shared_from_this<Variable> {
+class Variable : public Node {
 public:
 	Variable() {}
 
-	std::shared_ptr<Node> derive() override;
-	float evaluate(float x) override;
-	std::shared_ptr<Node> simplify() override;
-	std::ostream &out(std::ostream &stream) const override;
-	bool equals(const std::shared_ptr<Node> &other) const override;
+	std::shared_ptr<Node> deriveLocal(const std::shared_ptr<Node> *derivatives) override;
+	float evaluateLocal(float x, const float *arguments) override;
+	void evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) override;
+	Interval evaluateIntervalLocal(const Interval &x, const Interval *arguments) override;
+	void outLocal(std::ostream &stream, size_t position) const override;
+	const PrintForm &formLocal(Format format) const override;
+	bool equalsLocal(const Node &other) const override;
 };
 
 inline std::shared_ptr<Variable> newVariable() {
-	return std::make_shared<Variable>();
+	SYMBOLIC_COUNT_ALLOCATION("Variable");
+	return charged(std::make_shared<Variable>());
 }
 
 inline Variable *toVariable(const std::shared_ptr<Node> &node) {
@@ -50,16 +101,55 @@ inline bool isVariable(const std::shared_ptr<Node> &node) {
 	return toVariable(node) != nullptr;
 }
 
+/*
+	A named constant whose value may change after the expression is built.
+	Rules never fold it, so the expression stays valid for any value.
+*/
+class Parameter : public Node {
+public:
+	Parameter(const std::string &name, float value) :
+	fName(name),
+	fValue(value) {}
+
+	std::shared_ptr<Node> deriveLocal(const std::shared_ptr<Node> *derivatives) override;
+	float evaluateLocal(float x, const float *arguments) override;
+	void evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) override;
+	Interval evaluateIntervalLocal(const Interval &x, const Interval *arguments) override;
+	void outLocal(std::ostream &stream, size_t position) const override;
+	const PrintForm &formLocal(Format format) const override;
+	void printLocal(std::string &text) const override;
+	bool equalsLocal(const Node &other) const override;
+
+	std::string fName;
+	float fValue{0.0f};
+};
+
+inline std::shared_ptr<Parameter> newParameter(const std::string &name, float value) {
+	SYMBOLIC_COUNT_ALLOCATION("Parameter");
+	return charged(std::make_shared<Parameter>(name, value));
+}
+
+inline Parameter *toParameter(const std::shared_ptr<Node> &node) {
+	return dynamic_cast<Parameter*>(node.get());
+}
+
+inline bool isParameter(const std::shared_ptr<Node> &node) {
+	return toParameter(node) != nullptr;
+}
+
 class Vector : public Node {
 public:
 	Vector(std::initializer_list<std::shared_ptr<Node>> nodes);
 	Vector(std::vector<std::shared_ptr<Node>> &&nodes);
+	~Vector();
 
-	std::shared_ptr<Node> derive() override;
-	float evaluate(float x) override;
-	std::shared_ptr<Node> simplify() override;
-	std::ostream &out(std::ostream &stream) const override;
-	bool equals(const std::shared_ptr<Node> &other) const override;
+	const std::shared_ptr<Node> &getChild(size_t index) const override { return elements[index]; }
+	std::shared_ptr<Node> deriveLocal(const std::shared_ptr<Node> *derivatives) override;
+	float evaluateLocal(float x, const float *arguments) override;
+	std::shared_ptr<Node> withChildren(const std::shared_ptr<Node> *children) override;
+	void outLocal(std::ostream &stream, size_t position) const override;
+	const PrintForm &formLocal(Format format) const override;
+	bool equalsLocal(const Node &other) const override;
 
 	size_t getDimension() const { return elements.size(); };
 
@@ -67,11 +157,13 @@ public:
 };
 
 inline std::shared_ptr<Vector> newVector(std::initializer_list<std::shared_ptr<Node>> nodes) {
-	return std::make_shared<Vector>(nodes);
+	SYMBOLIC_COUNT_ALLOCATION("Vector");
+	return charged(std::make_shared<Vector>(nodes));
 }
 
 inline std::shared_ptr<Vector> newVector(std::vector<std::shared_ptr<Node>> &&nodes) {
-	return std::make_shared<Vector>(std::move(nodes));
+	SYMBOLIC_COUNT_ALLOCATION("Vector");
+	return charged(std::make_shared<Vector>(std::move(nodes)));
 }
 
 inline Vector *toVector(const std::shared_ptr<Node> &node) {
@@ -85,22 +177,36 @@ inline bool isVector(const std::shared_ptr<Node> &node) {
 // Functions
 class Sum : public Node {
 public:
-	Sum(const std::shared_ptr<Node> &left, const std::shared_ptr<Node> &right) :
-	fLeft(left),
-	fRight(right) {}
+	Sum(std::shared_ptr<Node> left, std::shared_ptr<Node> right) :
+	fLeft(std::move(left)),
+	fRight(std::move(right)) {
+		addChild(fLeft);
+		addChild(fRight);
+	}
+	~Sum() {
+		release(fLeft);
+		release(fRight);
+	}
 
-	std::shared_ptr<Node> derive() override;
-	float evaluate(float x) override;
-	std::shared_ptr<Node> simplify() override;
-	std::ostream &out(std::ostream &stream) const override;
-	bool equals(const std::shared_ptr<Node> &other) const override;
+	const std::shared_ptr<Node> &getChild(size_t index) const override { return index ? fRight : fLeft; }
+	std::shared_ptr<Node> deriveLocal(const std::shared_ptr<Node> *derivatives) override;
+	float evaluateLocal(float x, const float *arguments) override;
+	void evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) override;
+	Interval evaluateIntervalLocal(const Interval &x, const Interval *arguments) override;
+	void partialsLocal(float x, const float *arguments, float value, float *partials) override;
+	std::shared_ptr<Node> withChildren(const std::shared_ptr<Node> *children) override;
+	std::shared_ptr<Node> simplifyLocal() override;
+	void outLocal(std::ostream &stream, size_t position) const override;
+	const PrintForm &formLocal(Format format) const override;
+	bool equalsLocal(const Node &other) const override;
 
 	std::shared_ptr<Node> fLeft;
 	std::shared_ptr<Node> fRight;
 };
 
-inline std::shared_ptr<Sum> newSum(const std::shared_ptr<Node> &left, const std::shared_ptr<Node> &right) {
-	return std::make_shared<Sum>(left, right);
+inline std::shared_ptr<Sum> newSum(std::shared_ptr<Node> left, std::shared_ptr<Node> right) {
+	SYMBOLIC_COUNT_ALLOCATION("Sum");
+	return charged(std::make_shared<Sum>(std::move(left), std::move(right)));
 }
 
 inline Sum *toSum(const std::shared_ptr<Node> &node) {
@@ -113,22 +219,38 @@ inline bool isSum(const std::shared_ptr<Node> &node) {
 
 class Product : public Node {
 public:
-	Product(const std::shared_ptr<Node> &left, const std::shared_ptr<Node> &right) :
-	fLeft(left),
-	fRight(right) {}
+	Product(std::shared_ptr<Node> left, std::shared_ptr<Node> right) :
+	fLeft(std::move(left)),
+	fRight(std::move(right)) {
+		addChild(fLeft);
+		addChild(fRight);
+	}
+	~Product() {
+		release(fLeft);
+		release(fRight);
+	}
 
-	std::shared_ptr<Node> derive() override;
-	float evaluate(float x) override;
-	std::shared_ptr<Node> simplify() override;
-	std::ostream &out(std::ostream &stream) const override;
-	bool equals(const std::shared_ptr<Node> &other) const override;
+	const std::shared_ptr<Node> &getChild(size_t index) const override { return index ? fRight : fLeft; }
+	std::shared_ptr<Node> deriveLocal(const std::shared_ptr<Node> *derivatives) override;
+	float evaluateLocal(float x, const float *arguments) override;
+	void evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) override;
+	Interval evaluateIntervalLocal(const Interval &x, const Interval *arguments) override;
+	void partialsLocal(float x, const float *arguments, float value, float *partials) override;
+	std::shared_ptr<Node> withChildren(const std::shared_ptr<Node> *children) override;
+	std::shared_ptr<Node> simplifyLocal() override;
+	void outLocal(std::ostream &stream, size_t position) const override;
+	const PrintForm &formLocal(Format format) const override;
+	bool equalsLocal(const Node &other) const override;
 
 	std::shared_ptr<Node> fLeft;
 	std::shared_ptr<Node> fRight;
+	// Whether both factors are equal, 0 until the first interval evaluation compares them, then 1 or 2
+	std::atomic<uint8_t> fSquare{0};
 };
 
-inline std::shared_ptr<Product> newProduct(const std::shared_ptr<Node> &left, const std::shared_ptr<Node> &right) {
-	return std::make_shared<Product>(left, right);
+inline std::shared_ptr<Product> newProduct(std::shared_ptr<Node> left, std::shared_ptr<Node> right) {
+	SYMBOLIC_COUNT_ALLOCATION("Product");
+	return charged(std::make_shared<Product>(std::move(left), std::move(right)));
 }
 
 inline Product *toProduct(const std::shared_ptr<Node> &node) {
@@ -139,24 +261,38 @@ inline bool isProduct(const std::shared_ptr<Node> &node) {
 	return toProduct(node) != nullptr;
 }
 
-class Power : /*public Function, */public Node, public std::enable_shared_from_this<Power> {
+class Power : /*public Function, */public Node {
 public:
-	Power(const std::shared_ptr<Node> &base, const std::shared_ptr<Node> &exponent) :
-	fBase(base),
-	fExponent(exponent) {}
+	Power(std::shared_ptr<Node> base, std::shared_ptr<Node> exponent) :
+	fBase(std::move(base)),
+	fExponent(std::move(exponent)) {
+		addChild(fBase);
+		addChild(fExponent);
+	}
+	~Power() {
+		release(fBase);
+		release(fExponent);
+	}
 
-	std::shared_ptr<Node> derive() override;
-	float evaluate(float x) override;
-	std::shared_ptr<Node> simplify() override;
-	std::ostream &out(std::ostream &stream) const override;
-	bool equals(const std::shared_ptr<Node> &other) const override;
+	const std::shared_ptr<Node> &getChild(size_t index) const override { return index ? fExponent : fBase; }
+	std::shared_ptr<Node> deriveLocal(const std::shared_ptr<Node> *derivatives) override;
+	float evaluateLocal(float x, const float *arguments) override;
+	void evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) override;
+	Interval evaluateIntervalLocal(const Interval &x, const Interval *arguments) override;
+	void partialsLocal(float x, const float *arguments, float value, float *partials) override;
+	std::shared_ptr<Node> withChildren(const std::shared_ptr<Node> *children) override;
+	std::shared_ptr<Node> simplifyLocal() override;
+	void outLocal(std::ostream &stream, size_t position) const override;
+	const PrintForm &formLocal(Format format) const override;
+	bool equalsLocal(const Node &other) const override;
 
 	std::shared_ptr<Node> fBase;
 	std::shared_ptr<Node> fExponent;
 };
 
-inline std::shared_ptr<Power> newPower(const std::shared_ptr<Node> &base, const std::shared_ptr<Node> &exponent) {
-	return std::make_shared<Power>(base, exponent);
+inline std::shared_ptr<Power> newPower(std::shared_ptr<Node> base, std::shared_ptr<Node> exponent) {
+	SYMBOLIC_COUNT_ALLOCATION("Power");
+	return charged(std::make_shared<Power>(std::move(base), std::move(exponent)));
 }
 
 inline Power *toPower(const std::shared_ptr<Node> &node) {
@@ -169,80 +305,181 @@ inline bool isPower(const std::shared_ptr<Node> &node) {
 
 class SquareRoot : public Power {
 public:
-	SquareRoot(const std::shared_ptr<Node> &base) : Power(base, newConstant(0.5f)) {}
+	SquareRoot(std::shared_ptr<Node> base) : Power(std::move(base), newConstant(0.5f)) {}
 };
 
-inline std::shared_ptr<SquareRoot> newSquareRoot(const std::shared_ptr<Node> &argument) {
-	return std::make_shared<SquareRoot>(argument);
+inline std::shared_ptr<SquareRoot> newSquareRoot(std::shared_ptr<Node> argument) {
+	SYMBOLIC_COUNT_ALLOCATION("SquareRoot");
+	return charged(std::make_shared<SquareRoot>(std::move(argument)));
 }
 
+/*
+	Functions of one argument. A function is a row of the function table,
+	which the single Function class dispatches through, so adding one takes
+	a FunctionKind, its value in kFunctionValues and a row.
+*/
+class Function;
+
+struct FunctionInfo {
+	const char *name;		// Class name counted by the instrumentation
+	const char *symbol;		// Printed before the parenthesized argument
+	const char *latex;
+	float (*evaluate)(float argument);
+	void (*evaluateBatch)(const float *arguments, float *result, size_t count);
+	// Bounds of f over an interval of arguments, see interval.cpp
+	Interval (*evaluateInterval)(const Interval &argument);
+	// f'(u) given u and f(u)
+	float (*slope)(float argument, float value);
+	// f'(u), multiplied by u' in Function::deriveLocal()
+	std::shared_ptr<Node> (*derive)(const std::shared_ptr<Node> &argument);
+	// Rules specific to the function, nullptr when none applies
+	std::shared_ptr<Node> (*simplify)(const Function &function);
+};
+
+const FunctionInfo &functionInfo(FunctionKind kind);
+
+// Interval bounds of the functions, rounded outwards
+Interval logarithm(const Interval &x);
+Interval cosine(const Interval &x);
+Interval sine(const Interval &x);
+Interval exponential(const Interval &x);
+Interval tangent(const Interval &x);
+Interval absolute(const Interval &x);
+Interval hyperbolicTangent(const Interval &x);
+Interval sign(const Interval &x);
+
 class Function : public Node {
 public:
-	Function(const std::shared_ptr<Node> &argument) :
-	fArgument(argument) {}
-
-	std::shared_ptr<Node> derive() override;
-	virtual std::shared_ptr<Node> deriveFunction(const std::shared_ptr<Node> &argument) = 0;
-	template <typename T>
-	bool equalsHelper(const std::shared_ptr<Node> &other) const {
-		auto f = dynamic_cast<T*>(other.get());
-		return f && f->fArgument->equals(fArgument);
+	Function(FunctionKind kind, std::shared_ptr<Node> argument) :
+	fKind(kind),
+	fArgument(std::move(argument)) {
+		addChild(fArgument);
+	}
+	~Function() {
+		release(fArgument);
 	}
 
+	const std::shared_ptr<Node> &getChild(size_t index) const override { return fArgument; }
+	std::shared_ptr<Node> deriveLocal(const std::shared_ptr<Node> *derivatives) override;
+	float evaluateLocal(float x, const float *arguments) override;
+	void evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) override;
+	Interval evaluateIntervalLocal(const Interval &x, const Interval *arguments) override;
+	void partialsLocal(float x, const float *arguments, float value, float *partials) override;
+	std::shared_ptr<Node> withChildren(const std::shared_ptr<Node> *children) override;
+	std::shared_ptr<Node> simplifyLocal() override;
+	void outLocal(std::ostream &stream, size_t position) const override;
+	const PrintForm &formLocal(Format format) const override;
+	bool equalsLocal(const Node &other) const override;
+
+	FunctionKind fKind;
 	std::shared_ptr<Node> fArgument;
 };
 
+inline std::shared_ptr<Function> newFunction(FunctionKind kind, std::shared_ptr<Node> argument) {
+	SYMBOLIC_COUNT_ALLOCATION(functionInfo(kind).name);
+	return charged(std::make_shared<Function>(kind, std::move(argument)));
+}
+
+inline Function *toFunction(const std::shared_ptr<Node> &node) {
+	return dynamic_cast<Function*>(node.get());
+}
+
 inline bool isFunction(const std::shared_ptr<Node> &node) {
-	return dynamic_cast<Function*>(node.get()) != nullptr;
+	return toFunction(node) != nullptr;
 }
 
-class NaturalLogarithm : public Function, public std::enable_shared_from_this<NaturalLogarithm> {
-public:
-	NaturalLogarithm(const std::shared_ptr<Node> &argument) :
-	Function(argument),
-	fArgument(argument) {}
+// The function when node is one of the given kind
+inline Function *toFunction(const std::shared_ptr<Node> &node, FunctionKind kind) {
+	auto function = toFunction(node);
+	return function && function->fKind == kind ? function : nullptr;
+}
 
-	std::shared_ptr<Node> deriveFunction(const std::shared_ptr<Node> &argument) override;
-	float evaluate(float x) override;
-	std::shared_ptr<Node> simplify() override;
-	std::ostream &out(std::ostream &stream) const override;
-	bool equals(const std::shared_ptr<Node> &other) const override;
+inline std::shared_ptr<Function> newNaturalLogarithm(std::shared_ptr<Node> argument) {
+	return newFunction(FunctionKind::NaturalLogarithm, std::move(argument));
+}
 
-	std::shared_ptr<Node> fArgument;
-};
+inline Function *toNaturalLogarithm(const std::shared_ptr<Node> &node) {
+	return toFunction(node, FunctionKind::NaturalLogarithm);
+}
 
-inline std::shared_ptr<NaturalLogarithm> newNaturalLogarithm(const std::shared_ptr<Node> &argument) {
-	return std::make_shared<NaturalLogarithm>(argument);
+inline bool isNaturalLogarithm(const std::shared_ptr<Node> &node) {
+	return toNaturalLogarithm(node) != nullptr;
 }
 
-class Cosine : public Function, public std::enable_shared_from_this<Cosine> {
-public:
-	Cosine(const std::shared_ptr<Node> &argument) :
-	Function(argument) {}
-
-	std::shared_ptr<Node> deriveFunction(const std::shared_ptr<Node> &argument) override;
-	float evaluate(float x) override;
-	std::shared_ptr<Node> simplify() override;
-	std::ostream &out(std::ostream &stream) const override;
-	bool equals(const std::shared_ptr<Node> &other) const override;
-};
+inline std::shared_ptr<Function> newCosine(std::shared_ptr<Node> argument) {
+	return newFunction(FunctionKind::Cosine, std::move(argument));
+}
+
+inline Function *toCosine(const std::shared_ptr<Node> &node) {
+	return toFunction(node, FunctionKind::Cosine);
+}
+
+inline bool isCosine(const std::shared_ptr<Node> &node) {
+	return toCosine(node) != nullptr;
+}
+
+inline std::shared_ptr<Function> newSine(std::shared_ptr<Node> argument) {
+	return newFunction(FunctionKind::Sine, std::move(argument));
+}
 
-inline std::shared_ptr<Cosine> newCosine(const std::shared_ptr<Node> &argument) {
-	return std::make_shared<Cosine>(argument);
+inline Function *toSine(const std::shared_ptr<Node> &node) {
+	return toFunction(node, FunctionKind::Sine);
 }
 
-class Sine : public Function, public std::enable_shared_from_this<Sine> {
+inline bool isSine(const std::shared_ptr<Node> &node) {
+	return toSine(node) != nullptr;
+}
+
+inline std::shared_ptr<Function> newExponential(std::shared_ptr<Node> argument) {
+	return newFunction(FunctionKind::Exponential, std::move(argument));
+}
+
+inline Function *toExponential(const std::shared_ptr<Node> &node) {
+	return toFunction(node, FunctionKind::Exponential);
+}
+
+inline bool isExponential(const std::shared_ptr<Node> &node) {
+	return toExponential(node) != nullptr;
+}
+
+// Integrals
+/*
+	An integral without closed form, kept unevaluated. Evaluates as the
+	definite integral from 0 to x.
+*/
+class Integral : public Node {
 public:
-	Sine(const std::shared_ptr<Node> &argument) :
-	Function(argument) {}
-
-	std::shared_ptr<Node> deriveFunction(const std::shared_ptr<Node> &argument) override;
-	float evaluate(float x) override;
-	std::shared_ptr<Node> simplify() override;
-	std::ostream &out(std::ostream &stream) const override;
-	bool equals(const std::shared_ptr<Node> &other) const override;
+	Integral(std::shared_ptr<Node> integrand) :
+	fIntegrand(std::move(integrand)) {
+		addChild(fIntegrand);
+	}
+	~Integral() {
+		release(fIntegrand);
+	}
+
+	const std::shared_ptr<Node> &getChild(size_t index) const override { return fIntegrand; }
+	std::shared_ptr<Node> deriveLocal(const std::shared_ptr<Node> *derivatives) override;
+	float evaluateLocal(float x, const float *arguments) override;
+	std::shared_ptr<Node> withChildren(const std::shared_ptr<Node> *children) override;
+	void outLocal(std::ostream &stream, size_t position) const override;
+	const PrintForm &formLocal(Format format) const override;
+	bool equalsLocal(const Node &other) const override;
+
+	std::shared_ptr<Node> fIntegrand;
 };
 
-inline std::shared_ptr<Sine> newSine(const std::shared_ptr<Node> &argument) {
-	return std::make_shared<Sine>(argument);
-}
\ No newline at end of file
+inline std::shared_ptr<Integral> newIntegral(std::shared_ptr<Node> integrand) {
+	SYMBOLIC_COUNT_ALLOCATION("Integral");
+	return charged(std::make_shared<Integral>(std::move(integrand)));
+}
+
+inline Integral *toIntegral(const std::shared_ptr<Node> &node) {
+	return dynamic_cast<Integral*>(node.get());
+}
+
+inline bool isIntegral(const std::shared_ptr<Node> &node) {
+	return toIntegral(node) != nullptr;
+}
+
+// Returns the antiderivative of node, using Integral where no closed form is found
+std::shared_ptr<Node> antiderivative(const std::shared_ptr<Node> &node);
\ No newline at end of file
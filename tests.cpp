@@ -0,0 +1,643 @@
+#include "symbolic.h"
+#include "static_expression.h"
+#include <chrono>
+#include <cmath>
+#include <sstream>
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": " << #condition << "\n"; \
+			failures++; \
+		} \
+	} while (0)
+
+static bool near(float a, float b, float tolerance = 1e-4f) {
+	return std::abs(a - b) <= tolerance * std::max(1.0f, std::abs(b));
+}
+
+static std::string str(const NodeRef &node) {
+	std::ostringstream stream;
+	stream << node;
+	return stream.str();
+}
+
+void deriveTests() {
+	auto x = variable();
+
+	auto n = 2.0f * x - 2.0f * (x ^ 2);
+	CHECK(near(n.evaluate(5.0f), -40.0f));
+	CHECK(near(n.derive().evaluate(5.0f), -18.0f));
+	CHECK(str(n.derive().simplify()) == "(2 + (-4 * x))");
+
+	auto p = x ^ 3;
+	CHECK(str(p.derive().simplify()) == "(3 * (x ^ 2))");
+
+	auto w = x ^ x;
+	CHECK(near(w.derive().evaluate(3.0f), 27.0f * (1.0f + logf(3.0f))));
+}
+
+void simplifyTests() {
+	auto x = variable();
+
+	CHECK(str((2.0f * x + 3.0f * x).simplify()) == "(5 * x)");
+	CHECK(str(((2 * x) * (4 * x)).simplify()) == "(8 * (x ^ 2))");
+	CHECK(str(((x ^ 2) * (x ^ 2)).simplify()) == "(x ^ 4)");
+	CHECK(near((x * x * x * x + x * x).simplify().evaluate(2.0f), 20.0f));
+	CHECK(str(vec2(x + x, constant(2.0f)).simplify()) == "[(2 * x), 2]");
+	// Scalars broadcast over vectors
+	CHECK(str((x + vec({x, x})).simplify()) == "[(2 * x), (2 * x)]");
+	CHECK(str((vec({x, constant(1.0f)}) + constant(2.0f)).simplify()) == "[(2 + x), 3]");
+}
+
+void builderTests() {
+	auto x = variable();
+
+	auto p = polynomial({1.0f, 2.0f, 3.0f}, x);
+	CHECK(str(p) == "((((3 * x) + 2) * x) + 1)");
+	CHECK(near(p.evaluate(2.0f), 17.0f));
+	CHECK(str(polynomial({0.0f, 0.0f, 1.0f}, x)) == "((1 * x) * x)");
+	CHECK(near(sum({x, x ^ 2, constant(3.0f)}).evaluate(2.0f), 9.0f));
+	CHECK(str(product({x, cos(x)})) == "(x * cos(x))");
+	CHECK(str(sum({})) == "0" && str(product({})) == "1");
+
+	// Small constants are shared, others are not
+	CHECK(constant(1.0f).fRef == constant(1.0f).fRef);
+	CHECK(constant(3.0f).fRef != constant(3.0f).fRef);
+	CHECK(str(constant(-0.0f)) == "-0");
+
+	// Temporaries are moved into the tree, x is referenced once per use
+	auto y = variable();
+	auto q = 3.0f * (y ^ 2) + y;
+	CHECK(y.fRef.use_count() == 3);
+}
+
+void staticExpressionTests() {
+	constexpr StaticVariable x;
+
+	// Derived and folded by the compiler
+	auto f = staticConstant<3> * (x ^ staticConstant<2>) + sin(x);
+	auto df = derive(f);
+	static_assert(std::is_same<decltype(df), StaticSum<StaticProduct<StaticConstant<6>, StaticVariable>, StaticFunction<FunctionKind::Cosine, StaticVariable>>>::value, "");
+	static_assert(std::is_same<StaticRational<2, -4>, StaticConstant<-1, 2>>::value, "");
+	static_assert(std::is_same<decltype(simplify(staticConstant<1, 2> * (x + staticConstant<0>) * staticConstant<4>)), StaticProduct<StaticConstant<2>, StaticVariable>>::value, "");
+	auto p = staticConstant<3> * x * x + staticConstant<2> * x + staticConstant<1>;
+	static_assert(decltype(p)::evaluate(2.0f) == 17.0f, "");
+	static_assert(decltype(derive(derive(p)))::evaluate(5.0f) == 6.0f, "");
+
+	// Same values and derivatives as the runtime tree
+	auto g = exp(x / (x + staticConstant<1>)) * ln(abs(x)) - sqrt(x) + (x ^ x) + tanh(cos(x));
+	auto dg = derive(g);
+	auto n = toNodeRef(g);
+	auto dn = n.derive();
+	for (float v = 0.25f; v < 3.0f; v += 0.25f) {
+		CHECK(near(g(v), n.evaluate(v)));
+		CHECK(near(dg(v), dn.evaluate(v)));
+	}
+	// (a ^ n) ^ m keeps its value at negative a
+	auto root = simplify((x ^ staticConstant<2>) ^ staticConstant<1, 2>);
+	static_assert(std::is_same<decltype(root), StaticFunction<FunctionKind::AbsoluteValue, StaticVariable>>::value, "");
+	static_assert(std::is_same<decltype(simplify((x ^ staticConstant<3>) ^ staticConstant<1, 3>)),
+		StaticPower<StaticPower<StaticVariable, StaticConstant<3>>, StaticConstant<1, 3>>>::value, "");
+	static_assert(std::is_same<decltype(simplify((x ^ staticConstant<3>) ^ staticConstant<2>)), StaticPower<StaticVariable, StaticConstant<6>>>::value, "");
+	CHECK(near(root(-2.0f), 2.0f));
+	CHECK(str(toNodeRef(df)) == "((6 * x) + cos(x))");
+	CHECK(toNodeRef(df) == toNodeRef(f).derive().simplify());
+}
+
+void trigonometryTests() {
+	auto x = variable();
+
+	CHECK(str(((sin(x) ^ 2) + (cos(x) ^ 2)).simplify()) == "1");
+	CHECK(str(((cos(x) ^ 2) - (sin(x) ^ 2)).simplify()) == "cos((2 * x))");
+	CHECK(str((cos(x) ^ 2).derive().simplify()) == "(-1 * sin((2 * x)))");
+	CHECK(str(ln(x ^ 3).simplify()) == "(3 * ln(x))");
+	CHECK(str(ln(x ^ 2).simplify()) == "(2 * ln(abs(x)))");
+	CHECK(str(ln(x ^ x).simplify()) == "ln((x ^ x))");
+	CHECK(str(ln(exp(x) ^ x).simplify()) == "(x ^ 2)");
+	// Logarithms of even powers keep their value at negative x
+	NodeRef logarithms[] = {ln(x ^ 2), ln(x * x), ln(sin(x) ^ 2), ln(x ^ constant(-2.0f)), ln(x ^ x)};
+	for (auto &logarithm : logarithms) {
+		CHECK(near(logarithm.simplify().evaluate(-2.0f), logarithm.evaluate(-2.0f)));
+		CHECK(near(logarithm.saturate().evaluate(-2.0f), logarithm.evaluate(-2.0f)));
+	}
+	// (a ^ n) ^ m keeps its value at negative a
+	NodeRef powers[] = {(x ^ 2) ^ constant(0.5f), (x ^ 3) ^ constant(1.0f / 3.0f), (x ^ 2) ^ constant(3.0f)};
+	for (auto &power : powers) {
+		float expected = power.evaluate(-2.0f);
+		auto saturated = power.saturate().evaluate(-2.0f);
+		CHECK(std::isnan(expected) ? std::isnan(saturated) : near(saturated, expected));
+	}
+	// ln(a) + ln(b) stays undefined where a and b are both negative
+	auto logarithmSum = ln(x) + ln(sin(x));
+	CHECK(std::isnan(logarithmSum.simplify().evaluate(-1.0f)));
+	CHECK(std::isnan(logarithmSum.saturate().evaluate(-1.0f)));
+	CHECK(findRoots(logarithmSum.simplify(), {-3.0f, -0.5f}).empty());
+	CHECK(str(sin(constant(0.0f)).simplify()) == "0");
+	auto d = (sin(x) * cos(x)).derive();
+	CHECK(evaluationCost(d.simplify()).calls < evaluationCost(d).calls);
+	CHECK(near(d.simplify().evaluate(0.7f), d.evaluate(0.7f)));
+}
+
+void functionTests() {
+	auto x = variable();
+
+	// ln evaluates its argument, not x
+	auto logarithm = ln(2.0f * x);
+	CHECK(near(logarithm.evaluate(3.0f), logf(6.0f)));
+	float points[] = {0.5f, 1.0f, 3.0f};
+	float results[3];
+	logarithm.evaluate(points, results, 3);
+	CHECK(near(results[2], logf(6.0f)));
+
+	// Derivatives against central differences
+	NodeRef functions[] = {exp(2.0f * x), tan(x), abs(x ^ 3), tanh(x), ln((x ^ 2) + constant(1.0f))};
+	for (auto &function : functions) {
+		auto derivative = function.derive();
+		for (float v = -1.2f; v <= 1.2f; v += 0.3f) {
+			float h = 1e-3f;
+			float difference = (function.evaluate(v + h) - function.evaluate(v - h)) / (2.0f * h);
+			CHECK(near(derivative.evaluate(v), difference, 1e-2f));
+		}
+		Interval domain{0.1f, 1.2f};
+		auto range = function.evaluate(domain);
+		for (float v = domain.lower; v <= domain.upper; v += 0.01f) {
+			CHECK(range.contains(function.evaluate(v)));
+		}
+	}
+
+	CHECK(str(exp(x) + abs(x) + tanh(x)) == "((exp(x) + abs(x)) + tanh(x))");
+	CHECK(str(tan(-2.0f * x).simplify()) == "(-1 * tan((2 * x)))");
+	CHECK(str(abs(abs(-1.0f * x)).simplify()) == "abs(x)");
+	CHECK(str(ln(exp(x)).simplify()) == "x");
+	CHECK(str(exp(constant(0.0f)).simplify()) == "1");
+	CHECK(Printer(Format::LaTeX).print(abs(x) * tanh(x)) == "\\left|x\\right| \\cdot \\tanh\\left(x\\right)");
+	CHECK(str(exp(3.0f * x).integrate().simplify()) == "(0.333333 * exp((3 * x)))");
+	auto saturated = (exp(x) * exp(x) + tanh(x)).saturate();
+	CHECK(near(saturated.evaluate(0.4f), expf(0.8f) + tanhf(0.4f)));
+}
+
+void saturationTests() {
+	auto x = variable();
+
+	NodeRef expressions[] = {
+		2.0f * x - 2.0f * (x ^ 2),
+		(x ^ x).derive(),
+		(cos(x) ^ 2).derive(),
+		(2.0f * sin(x)) * cos(x),
+		x * x * x * x + x * x
+	};
+	for (auto &expression : expressions) {
+		auto saturated = expression.saturate();
+		CHECK(near(saturated.evaluate(1.3f), expression.evaluate(1.3f)));
+		CHECK(evaluationCost(saturated).total() <= evaluationCost(expression.simplify()).total());
+	}
+	CHECK(evaluationCost((x ^ 2).saturate()).calls == 0);
+
+	// Uses of the same parameter are one class
+	auto a = parameter("a", 3.0f);
+	CHECK(str((a - a).saturate()) == "0");
+	CHECK(evaluationCost(((a + a) + (a + a)).saturate()).total() == 1.0f);
+
+	SaturationLimits limits;
+	limits.maxNodes = 16;
+	auto limited = (x ^ x).derive().saturate(limits);
+	CHECK(near(limited.evaluate(2.0f), (x ^ x).derive().evaluate(2.0f)));
+
+	// The time budget holds within a single large iteration
+	auto large = x;
+	for (int i = 0; i < 6; i++) {
+		large = large.derive() + sin(large) * (x ^ x);
+	}
+	limits.maxNodes = SIZE_MAX;
+	limits.maxMilliseconds = 20.0f;
+	auto start = std::chrono::steady_clock::now();
+	auto timed = large.saturate(limits);
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	CHECK(elapsed.count() < 1000.0f);
+	CHECK(near(timed.evaluate(0.7f), large.evaluate(0.7f), 1e-3f));
+
+	// The elements of a vector share one budget
+	auto vector = vec({large, large.derive(), large * x, large + x, sin(large)});
+	start = std::chrono::steady_clock::now();
+	auto saturatedVector = vector.saturate(limits);
+	elapsed = std::chrono::steady_clock::now() - start;
+	CHECK(elapsed.count() < 1000.0f);
+	CHECK(saturatedVector.dimension() == 5);
+	float point = 0.7f, values[5];
+	saturatedVector.evaluateComponents(&point, values, 1);
+	CHECK(near(values[4], sin(large).evaluate(0.7f), 1e-3f));
+}
+
+void batchTests() {
+	auto x = variable();
+
+	NodeRef expressions[] = {2.0f * x - 2.0f * (x ^ 2), cos(2.0f * x), sqrt(x) + sin(x), x ^ x, ln(2.0f * x) * tanh(x) + abs(tan(x))};
+	std::vector<float> points(100);
+	for (size_t i = 0; i < points.size(); i++) {
+		points[i] = 0.1f + 0.05f * i;
+	}
+	std::vector<float> results(points.size());
+	for (auto &expression : expressions) {
+		expression.evaluate(points.data(), results.data(), points.size());
+		for (size_t i = 0; i < points.size(); i++) {
+			CHECK(results[i] == expression.evaluate(points[i]));
+		}
+	}
+}
+
+void integrationTests() {
+	auto x = variable();
+
+	CHECK(near(integrate(sin(x), 0.0f, M_PI), 2.0f));
+	CHECK(near(integrate(3.0f * (x ^ 2) + 2.0f * x, 0.0f, 1.0f), 2.0f));
+	CHECK(near(integrate(sqrt(x), 0.0f, 1.0f), 2.0f / 3.0f));
+	CHECK(near(integrate(x, 1.0f, 0.0f), -0.5f));
+
+	std::vector<std::pair<float, float>> intervals;
+	for (int i = 0; i < 100; i++) {
+		intervals.emplace_back(0.0f, i * 0.1f);
+	}
+	auto integrals = integrate(cos(x), intervals);
+	for (size_t i = 0; i < intervals.size(); i++) {
+		CHECK(near(integrals[i], sinf(intervals[i].second)));
+	}
+}
+
+void antiderivativeTests() {
+	auto x = variable();
+
+	NodeRef expressions[] = {3.0f * (x ^ 2) + 2.0f * x, cos(2.0f * x + constant(1.0f)), 1.0f / x, 2 ^ x, sin(3.0f * x), constant(4.0f)};
+	for (auto &expression : expressions) {
+		auto integral = expression.integrate();
+		CHECK(!containsIntegral(integral));
+		CHECK(near(integral.evaluate(2.0f) - integral.evaluate(1.0f), integrate(expression, 1.0f, 2.0f)));
+		CHECK(near(integral.derive().simplify().evaluate(1.5f), expression.evaluate(1.5f)));
+	}
+
+	// Valid on both sides of the pole
+	auto reciprocal = (1.0f / x).integrate();
+	CHECK(near(reciprocal.evaluate(-1.0f) - reciprocal.evaluate(-2.0f), integrate(1.0f / x, -2.0f, -1.0f)));
+
+	auto unevaluated = (x * sin(x)).integrate();
+	CHECK(containsIntegral(unevaluated));
+	CHECK(near(unevaluated.evaluate(2.0f), integrate(x * sin(x), 0.0f, 2.0f)));
+}
+
+void intervalTests() {
+	auto x = variable();
+
+	NodeRef expressions[] = {sin(x) * (x ^ 2) - constant(1.0f), cos(3.0f * x) + (x ^ 3), (x ^ -2) * sqrt(x), (2 ^ x) * cos(x)};
+	Interval domain{0.5f, 3.0f};
+	for (auto &expression : expressions) {
+		auto range = expression.evaluate(domain);
+		for (float v = domain.lower; v <= domain.upper; v += 0.01f) {
+			CHECK(range.contains(expression.evaluate(v)));
+		}
+	}
+
+	// Every function of the table, abs' being sign
+	NodeRef functions[] = {ln(x + constant(2.0f)), cos(x), sin(x), exp(x), tan(x), abs(x), tanh(x), abs(x).derive()};
+	Interval around{-1.2f, 1.4f};
+	for (auto &function : functions) {
+		auto range = function.evaluate(around);
+		for (float v = around.lower; v <= around.upper; v += 0.01f) {
+			CHECK(range.contains(function.evaluate(v)));
+		}
+	}
+
+	// Powers equal to 1 where the base or exponent is undefined
+	Interval negative{-2.0f, -1.0f};
+	CHECK(near((ln(x) ^ constant(0.0f)).evaluate(-1.5f), 1.0f));
+	CHECK((ln(x) ^ constant(0.0f)).evaluate(negative).contains(1.0f));
+	CHECK((constant(1.0f) ^ ln(x)).evaluate(negative).contains(1.0f));
+	CHECK(findRoots((ln(x) ^ constant(0.0f)) - constant(1.0f), negative).size() > 0);
+
+	auto roots = findRoots(sin(x), {-1.0f, 7.0f});
+	CHECK(roots.size() == 3);
+	for (size_t i = 0; i < roots.size(); i++) {
+		CHECK(roots[i].contains(i * static_cast<float>(M_PI)) || near(roots[i].middle(), i * M_PI, 1e-4f));
+	}
+
+	auto minimum = findMinimum((x ^ 2) - 2.0f * x, {-10.0f, 10.0f});
+	CHECK(near(minimum.x, 1.0f, 1e-2f));
+	CHECK(minimum.bound.contains(-1.0f));
+	auto maximum = findMaximum(sin(x), {0.0f, 3.0f});
+	CHECK(near(maximum.value, 1.0f));
+}
+
+void solverTests() {
+	auto x = variable();
+
+	std::vector<float> starts;
+	for (int i = 1; i <= 1000; i++) {
+		starts.push_back(0.01f * i * (i % 2 ? 1.0f : -1.0f));
+	}
+	auto newton = solve((x ^ 2) - constant(2.0f), starts);
+	SolverOptions options;
+	options.method = SolverMethod::Halley;
+	auto halley = solve((x ^ 2) - constant(2.0f), starts, options);
+	size_t newtonIterations = 0, halleyIterations = 0;
+	for (size_t i = 0; i < starts.size(); i++) {
+		CHECK(newton[i].converged && halley[i].converged);
+		CHECK(near(newton[i].root, starts[i] > 0.0f ? sqrtf(2.0f) : -sqrtf(2.0f)));
+		CHECK(near(halley[i].root, newton[i].root));
+		CHECK(std::abs(newton[i].value) < 1e-5f);
+		newtonIterations += newton[i].iterations;
+		halleyIterations += halley[i].iterations;
+	}
+	CHECK(halleyIterations < newtonIterations);
+
+	// No step from a zero derivative
+	auto flat = solve((x ^ 2) - constant(2.0f), {0.0f});
+	CHECK(!flat[0].converged && flat[0].iterations == 0);
+	auto fixed = solve(cos(x) - x, {0.0f, 1.0f, 10.0f});
+	for (auto &solution : fixed) {
+		CHECK(solution.converged && near(solution.root, 0.739085f));
+	}
+}
+
+void budgetTests() {
+	auto x = variable();
+
+	auto n = 2.0f * x - 2.0f * (x ^ 2);
+	CHECK(n.size() == 11);
+	CHECK(n.depth() == 5);
+	CHECK(vec2(x, x + x).size() == 5);
+
+	// Every derivative of a tower of powers embeds the previous one
+	auto tower = (x ^ x) ^ x;
+	Budget budget;
+	budget.maxNodes = 200;
+	bool exceeded = false;
+	try {
+		tower.derive(budget).derive(budget).derive(budget);
+	}
+	catch (const BudgetExceeded&) {
+		exceeded = true;
+	}
+	CHECK(exceeded);
+	CHECK(near(tower.derive(budget).evaluate(1.5f), tower.derive().evaluate(1.5f)));
+
+	budget.maxNodes = 0;
+	budget.maxDepth = 3;
+	exceeded = false;
+	try {
+		tower.derive(budget);
+	}
+	catch (const BudgetExceeded&) {
+		exceeded = true;
+	}
+	CHECK(exceeded);
+
+	// Stops early but still returns an equivalent expression
+	auto d = (x ^ x).derive().derive();
+	budget.maxDepth = 0;
+	budget.maxNodes = 10;
+	auto partial = d.simplify(budget);
+	CHECK(near(partial.evaluate(1.5f), d.evaluate(1.5f)));
+	CHECK(str(d.simplify(Budget())) == str(d.simplify()));
+}
+
+void printerTests() {
+	auto x = variable();
+
+	Printer infix;
+	CHECK(infix.print(2.0f * x - 2.0f * (x ^ 2)) == "2 * x + -1 * 2 * x²");
+	CHECK(infix.print((x + constant(1.0f)) * (x + constant(2.0f))) == "(x + 1) * (x + 2)");
+	CHECK(infix.print(sqrt(x + constant(1.0f))) == "√(x + 1)");
+	CHECK(infix.print((x ^ -1.0f) + (x ^ -0.5f) + (sin(x) ^ 3)) == "1/x + 1/√x + sin(x)³");
+	CHECK(infix.print((x ^ x) ^ 2.5f) == "(x ^ x) ^ 2.5");
+	CHECK(infix.print(x ^ (x ^ x)) == "x ^ x ^ x");
+	CHECK(infix.print(constant(-2.0f) ^ x) == "(-2) ^ x");
+	CHECK(infix.print(vec2(x + x, constant(2.0f))) == "[x + x, 2]");
+
+	Printer latex(Format::LaTeX);
+	CHECK(latex.print(sqrt(x) * cos(x)) == "\\sqrt{x} \\cdot \\cos\\left(x\\right)");
+	CHECK(latex.print((x + constant(1.0f)) ^ -2.0f) == "\\frac{1}{\\left(x + 1\\right)^{2}}");
+	CHECK(latex.print(x ^ (x + constant(1.0f))) == "x^{x + 1}");
+
+	Printer sexpression(Format::SExpression);
+	CHECK(sexpression.print(ln(x) + 3.0f * (x ^ 2)) == "(+ (ln x) (* 3 (^ x 2)))");
+
+	auto d = (x ^ x).derive().simplify();
+	auto &text = infix.print(d);
+	CHECK(text.size() < str(d).size());
+	CHECK(text == infix.print(d));
+}
+
+void incrementalTests() {
+	auto x = variable();
+	auto a = parameter("a", 2.0f);
+	auto b = parameter("b", 0.5f);
+
+	// a * sin(b * x) + (a * x) ^ 2, with a * x shared
+	auto ax = a * x;
+	auto n = a * sin(b * x) + (ax ^ 2) + ax;
+	CHECK(str(n) == "(((a * sin((b * x))) + ((a * x) ^ 2)) + (a * x))");
+	CHECK(str(n.derive().simplify()).find("a") != std::string::npos);
+
+	IncrementalEvaluator evaluator(n);
+	CHECK(near(evaluator.evaluate(1.5f), n.evaluate(1.5f)));
+	size_t full = evaluator.getRecomputed();
+	CHECK(near(evaluator.evaluate(1.5f), n.evaluate(1.5f)));
+	CHECK(evaluator.getRecomputed() == 0);
+
+	// b, b * x, sin, a * sin and both sums
+	setParameter(b, 0.25f);
+	CHECK(near(evaluator.evaluate(1.5f), n.evaluate(1.5f)));
+	CHECK(evaluator.getRecomputed() == 6);
+	setParameter(a, -1.0f);
+	CHECK(near(evaluator.evaluate(1.5f), n.evaluate(1.5f)));
+	CHECK(evaluator.getRecomputed() < full);
+	CHECK(near(evaluator.evaluate(0.5f), n.evaluate(0.5f)));
+
+	bool invalid = false;
+	try {
+		setParameter(x, 1.0f);
+	}
+	catch (const std::invalid_argument&) {
+		invalid = true;
+	}
+	CHECK(invalid);
+
+	invalid = false;
+	try {
+		IncrementalEvaluator vector(vec({a * x, x}));
+	}
+	catch (const std::invalid_argument&) {
+		invalid = true;
+	}
+	CHECK(invalid);
+}
+
+void jacobianTests() {
+	auto x = variable();
+	auto a = parameter("a", 1.5f);
+	auto b = parameter("b", 0.5f);
+	auto shared = a * x;
+	auto model = vec({sin(shared) * b, exp(shared) + (b ^ 2), x ^ 2});
+	CHECK(model.dimension() == 3);
+
+	// Structure of arrays, all points of a component together
+	float points[] = {0.1f, 0.2f, 0.3f, 0.4f};
+	float components[12];
+	model.evaluateComponents(points, components, 4);
+	CHECK(near(components[2], sinf(1.5f * 0.3f) * 0.5f));
+	CHECK(near(components[4 + 3], expf(1.5f * 0.4f) + 0.25f));
+	CHECK(near(components[8 + 1], 0.04f));
+
+	// Shared and repeated components over several blocks, the last one partial
+	auto common = sin(shared) + (x ^ 3);
+	auto repeated = vec({common * b, common, x, constant(2.0f), common, ln(common ^ 2)});
+	std::vector<float> many(150), values(6 * many.size());
+	for (size_t i = 0; i < many.size(); i++) {
+		many[i] = 0.1f + 0.02f * i;
+	}
+	// Flattened once, evaluated twice with a parameter changed in between
+	ComponentEvaluator evaluator(repeated);
+	CHECK(evaluator.getDimension() == 6);
+	setParameter(b, 2.0f);
+	evaluator.evaluate(many.data(), values.data(), many.size());
+	setParameter(b, 0.5f);
+	CHECK(near(values[50], (sinf(1.5f * many[50]) + many[50] * many[50] * many[50]) * 2.0f));
+	evaluator.evaluate(many.data(), values.data(), many.size());
+	NodeRef elements[] = {common * b, common, x, constant(2.0f), common, ln(common ^ 2)};
+	size_t component = 0;
+	for (auto &element : elements) {
+		for (size_t i = 0; i < many.size(); i++) {
+			CHECK(near(values[component * many.size() + i], element.evaluate(many[i])));
+		}
+		component++;
+	}
+
+	// Against central differences over the parameters
+	JacobianEvaluator jacobian(model, {a, b});
+	float tangent[] = {0.3f, -0.7f};
+	float cotangent[] = {1.0f, 2.0f, -1.0f};
+	float forward[3], reverse[2];
+	jacobian.jvp(0.8f, tangent, forward);
+	jacobian.vjp(0.8f, cotangent, reverse);
+	float h = 1e-3f;
+	float plus[3], minus[3];
+	setParameter(a, 1.5f + h * tangent[0]);
+	setParameter(b, 0.5f + h * tangent[1]);
+	jacobian.evaluate(0.8f, plus);
+	setParameter(a, 1.5f - h * tangent[0]);
+	setParameter(b, 0.5f - h * tangent[1]);
+	jacobian.evaluate(0.8f, minus);
+	setParameter(a, 1.5f);
+	setParameter(b, 0.5f);
+	for (size_t i = 0; i < 3; i++) {
+		CHECK(near(forward[i], (plus[i] - minus[i]) / (2.0f * h), 1e-2f));
+	}
+	CHECK(forward[2] == 0.0f);
+	// cotangent * (J * tangent) = (cotangent * J) * tangent
+	float left = cotangent[0] * forward[0] + cotangent[1] * forward[1] + cotangent[2] * forward[2];
+	CHECK(near(left, reverse[0] * tangent[0] + reverse[1] * tangent[1]));
+
+	// A parameter absent from the expression has a zero gradient
+	JacobianEvaluator scalar(sin(shared), {b, a});
+	float one = 1.0f, gradient[2];
+	scalar.vjp(0.8f, &one, gradient);
+	CHECK(gradient[0] == 0.0f && near(gradient[1], 0.8f * cosf(1.2f)));
+}
+
+void deepTreeTests() {
+	auto x = variable();
+
+	// Far deeper than recursion on a default stack allows
+	const int depth = 1000000;
+	auto n = x;
+	for (int i = 0; i < depth; i++) {
+		n = n + x;
+	}
+	CHECK(n.depth() == depth + 1);
+	CHECK(near(n.evaluate(0.5f), 0.5f * (depth + 1)));
+	std::vector<float> points(100, 2.0f), results(points.size());
+	n.evaluate(points.data(), results.data(), points.size());
+	CHECK(near(results.back(), 2.0f * (depth + 1)));
+	CHECK(n.evaluate(Interval{1.0f, 2.0f}).contains(depth + 1));
+	CHECK(str(n.derive().simplify()) == str(constant(depth + 1)));
+	CHECK(str(n.simplify()) == str(constant(depth + 1) * x));
+	CHECK(str(n).size() > 4 * depth);
+	CHECK(evaluationCost(n).flops == depth);
+	CHECK(near(n.saturate().evaluate(0.5f), 0.5f * (depth + 1)));
+	CHECK(near(n.integrate().evaluate(2.0f), 2.0f * (depth + 1)));
+	auto copy = x;
+	for (int i = 0; i < depth; i++) {
+		copy = copy + x;
+	}
+	CHECK(n == copy);
+}
+
+void instrumentationTests() {
+#ifdef SYMBOLIC_INSTRUMENTATION
+	auto x = variable();
+
+	resetStatistics();
+	auto n = (2.0f * x + 3.0f * x).simplify();
+	auto stats = statistics();
+	CHECK(str(n) == "(5 * x)");
+	CHECK(stats.rules["(n * x) + (m * x) = (n + m) * x"] == 1);
+	CHECK(stats.allocations["Product"] > 0);
+	CHECK(stats.simplifyPasses == stats.passes.size());
+	CHECK(stats.passes.front().sizeBefore == 7);
+	CHECK(stats.passes.back().sizeAfter == 3);
+	CHECK(stats.equalsCalls > 0);
+
+	std::ostringstream trace;
+	writeChromeTrace(trace);
+	CHECK(trace.str().find("\"simplify\"") != std::string::npos);
+
+	// Comparing two separately built trees
+	auto y = variable();
+	auto left = y, right = y;
+	for (int i = 0; i < 10; i++) {
+		left = left + sin(y);
+		right = right + sin(y);
+	}
+	resetStatistics();
+	CHECK(left == right);
+	CHECK(statistics().equalsMaxPending == 11);
+
+	// Building a product compares nothing, its interval compares the factors once
+	resetStatistics();
+	auto square = sin(y) * sin(y);
+	CHECK(statistics().equalsCalls == 0);
+	square.evaluate(Interval{-1.0f, 1.0f});
+	square.evaluate(Interval{-1.0f, 1.0f});
+	CHECK(statistics().equalsCalls == 1);
+	CHECK(near(square.evaluate(Interval{-1.0f, 1.0f}).lower, 0.0f));
+#endif
+}
+
+int main() {
+	deriveTests();
+	simplifyTests();
+	builderTests();
+	staticExpressionTests();
+	trigonometryTests();
+	functionTests();
+	saturationTests();
+	batchTests();
+	integrationTests();
+	antiderivativeTests();
+	intervalTests();
+	solverTests();
+	budgetTests();
+	printerTests();
+	incrementalTests();
+	jacobianTests();
+	deepTreeTests();
+	instrumentationTests();
+
+	if (failures) {
+		std::cerr << failures << " checks failed\n";
+		return 1;
+	}
+	std::cout << "all checks passed\n";
+	return 0;
+}
@@ -0,0 +1,274 @@
+#include "symbolic.h"
+#include "symbolic_internal.h"
+#include <algorithm>
+#include <limits>
+
+/*
+	Traversals
+
+	All operations walk the tree with an explicit stack in post-order. A frame
+	remembers the next child to visit, once all children are done their
+	results sit on top of the result stack, in order, and are replaced by
+	the result of the node itself.
+*/
+
+namespace {
+
+/*
+	Stack of trivially copyable values, kept inline until it outgrows
+	kInline so shallow trees are evaluated without allocating
+*/
+template <typename T, size_t kInline>
+class SmallStack {
+public:
+	~SmallStack() {
+		if (fData != fInline) {
+			delete[] fData;
+		}
+	}
+
+	void push(const T &value) {
+		if (fSize == fCapacity) {
+			grow(fSize + 1);
+		}
+		fData[fSize++] = value;
+	}
+
+	// Makes room for count values on top and returns the first of them
+	T *extend(size_t count) {
+		if (fSize + count > fCapacity) {
+			grow(fSize + count);
+		}
+		fSize += count;
+		return fData + fSize - count;
+	}
+
+	void pop(size_t count = 1) { fSize -= count; }
+	T &back() { return fData[fSize - 1]; }
+	T *end() { return fData + fSize; }
+	bool empty() const { return fSize == 0; }
+	size_t size() const { return fSize; }
+
+private:
+	void grow(size_t size) {
+		size_t capacity = std::max(size, 2 * fCapacity);
+		T *data = new T[capacity];
+		std::copy(fData, fData + fSize, data);
+		if (fData != fInline) {
+			delete[] fData;
+		}
+		fData = data;
+		fCapacity = capacity;
+	}
+
+	T fInline[kInline];
+	T *fData{fInline};
+	size_t fSize{0};
+	size_t fCapacity{kInline};
+};
+
+struct Frame {
+	Node *node;
+	size_t next;	// Next child to visit
+};
+
+/*
+	Visits the tree below root in post-order, calling combine(node, count)
+	for every node, count being the number of child results to replace
+*/
+template <typename Combine>
+void fold(Node *root, Combine combine) {
+	SmallStack<Frame, 64> frames;
+	frames.push({root, 0});
+	while (!frames.empty()) {
+		auto &frame = frames.back();
+		auto node = frame.node;
+		size_t count = node->getChildCount();
+		if (frame.next < count) {
+			frames.push({node->getChild(frame.next++).get(), 0});
+			continue;
+		}
+		frames.pop();
+		combine(node, count);
+	}
+}
+
+/*
+	Recursion is about twice as fast as the explicit stack for the small
+	trees evaluated in hot loops, so trees no deeper than kRecursionDepth
+	recurse, using a bounded amount of stack
+*/
+const size_t kRecursionDepth = 128;
+
+float evaluateRecursive(Node *node, float x) {
+	float arguments[2];
+	size_t count = node->getChildCount();
+	if (count > 2) {
+		return node->evaluate(x);
+	}
+	for (size_t i = 0; i < count; i++) {
+		arguments[i] = evaluateRecursive(node->getChild(i).get(), x);
+	}
+	return node->evaluateLocal(x, arguments);
+}
+
+}
+
+const std::shared_ptr<Node> &Node::getChild(size_t index) const {
+	static const std::shared_ptr<Node> none;
+	return none;
+}
+
+void Node::evaluateBatchLocal(const float *x, const float *arguments, float *result, size_t count) {
+	size_t children = getChildCount();
+	std::vector<float> point(children);
+	for (size_t i = 0; i < count; i++) {
+		for (size_t j = 0; j < children; j++) {
+			point[j] = arguments[j * kBatchSize + i];
+		}
+		result[i] = evaluateLocal(x[i], point.data());
+	}
+}
+
+void Node::partialsLocal(float x, const float *arguments, float value, float *partials) {
+	std::fill(partials, partials + getChildCount(), std::numeric_limits<float>::quiet_NaN());
+}
+
+// Derivative
+std::shared_ptr<Node> Node::derive() {
+	std::vector<std::shared_ptr<Node>> results;
+	fold(this, [&results](Node *node, size_t count) {
+		auto derivative = node->deriveLocal(results.data() + results.size() - count);
+		results.resize(results.size() - count);
+		results.push_back(std::move(derivative));
+	});
+	return results.back();
+}
+
+// Evaluation
+float Node::evaluate(float x) {
+	if (fDepth <= kRecursionDepth && fChildCount <= 2) {
+		return evaluateRecursive(this, x);
+	}
+	SmallStack<float, 64> results;
+	fold(this, [&results, x](Node *node, size_t count) {
+		float value = node->evaluateLocal(x, results.end() - count);
+		results.pop(count);
+		results.push(value);
+	});
+	return results.back();
+}
+
+/*
+	Results are blocks of kBatchSize values, a node writes over the block of
+	its first child, or into a new block when it has none
+*/
+void Node::evaluateBatch(const float *x, float *result, size_t count) {
+	SmallStack<float, 8 * kBatchSize> results;
+	fold(this, [&results, x, count](Node *node, size_t children) {
+		if (children == 0) {
+			node->evaluateBatchLocal(x, nullptr, results.extend(kBatchSize), count);
+			return;
+		}
+		float *arguments = results.end() - children * kBatchSize;
+		node->evaluateBatchLocal(x, arguments, arguments, count);
+		results.pop((children - 1) * kBatchSize);
+	});
+	std::copy(results.end() - kBatchSize, results.end() - kBatchSize + count, result);
+}
+
+Interval Node::evaluateInterval(const Interval &x) {
+	std::vector<Interval> results;
+	fold(this, [&results, &x](Node *node, size_t count) {
+		auto value = node->evaluateIntervalLocal(x, results.data() + results.size() - count);
+		results.resize(results.size() - count);
+		results.push_back(value);
+	});
+	return results.back();
+}
+
+// Simplification
+/*
+	Nodes whose children did not change are reused, so a pass over a tree
+	that is already simple allocates nothing
+*/
+std::shared_ptr<Node> Node::simplify() {
+	std::vector<std::shared_ptr<Node>> results;
+	fold(this, [&results](Node *node, size_t count) {
+		auto children = results.data() + results.size() - count;
+		bool changed = false;
+		for (size_t i = 0; i < count; i++) {
+			changed = changed || children[i] != node->getChild(i);
+		}
+		auto simplified = (changed ? node->withChildren(children) : node->shared_from_this())->simplifyLocal();
+		results.resize(results.size() - count);
+		results.push_back(std::move(simplified));
+	});
+	return results.back();
+}
+
+// Output
+std::ostream &Node::out(std::ostream &stream) const {
+	SmallStack<std::pair<const Node*, size_t>, 64> frames;
+	frames.push({this, 0});
+	while (!frames.empty()) {
+		auto &frame = frames.back();
+		auto node = frame.first;
+		size_t position = frame.second++;
+		node->outLocal(stream, position);
+		if (position < node->getChildCount()) {
+			frames.push({node->getChild(position).get(), 0});
+		}
+		else {
+			frames.pop();
+		}
+	}
+	return stream;
+}
+
+// Comparison
+bool Node::equals(const std::shared_ptr<Node> &other) const {
+	SYMBOLIC_TRACE_EQUALS();
+	SmallStack<std::pair<const Node*, const Node*>, 64> pending;
+	pending.push({this, other.get()});
+	while (!pending.empty()) {
+		auto pair = pending.back();
+		pending.pop();
+		// Shared subexpressions are equal without looking further
+		if (pair.first == pair.second) {
+			continue;
+		}
+		size_t count = pair.first->getChildCount();
+		if (!pair.second || !pair.first->equalsLocal(*pair.second) || pair.second->getChildCount() != count) {
+			return false;
+		}
+		// Last child first so the first one is compared first
+		for (size_t i = count; i > 0; i--) {
+			pending.push({pair.first->getChild(i - 1).get(), pair.second->getChild(i - 1).get()});
+		}
+		SYMBOLIC_EQUALS_PENDING(pending.size());
+	}
+	return true;
+}
+
+// Destruction
+void Node::release(std::shared_ptr<Node> &child) {
+	thread_local std::vector<std::shared_ptr<Node>> pending;
+	thread_local bool releasing = false;
+	// Not the last reference, nothing gets destroyed
+	if (!child || child.use_count() > 1) {
+		child.reset();
+		return;
+	}
+	pending.push_back(std::move(child));
+	if (releasing) {
+		return;
+	}
+	releasing = true;
+	while (!pending.empty()) {
+		// Destroying the node releases its children into pending
+		auto node = std::move(pending.back());
+		pending.pop_back();
+	}
+	releasing = false;
+}
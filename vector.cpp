@@ -0,0 +1,244 @@
+#include "symbolic.h"
+#include "symbolic_internal.h"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+
+/*
+	Vector expressions
+
+	Batches are evaluated into structure of arrays storage, every component
+	of a block of points before the next block so the points stay in cache.
+
+	Jacobian products run on the flattened expression at a single x. A
+	forward sweep carries the derivative of every entry along the tangent,
+	a reverse sweep carries the derivative of the cotangent weighted
+	components with respect to every entry. Both need the partial
+	derivatives of each node with respect to its children, nothing else.
+*/
+
+size_t NodeRef::dimension() const {
+	auto vector = toVector(fRef);
+	return vector ? vector->getDimension() : 1;
+}
+
+void NodeRef::evaluateComponents(const float *x, float *result, size_t count) {
+	if (!isVector(fRef)) {
+		evaluate(x, result, count);
+		return;
+	}
+	ComponentEvaluator(*this).evaluate(x, result, count);
+}
+
+/*
+	Components usually share subexpressions, the elements of a gradient all
+	contain the same factors, so like JacobianEvaluator the elements are
+	flattened into one list of entries where each shared node appears once
+*/
+ComponentEvaluator::ComponentEvaluator(const NodeRef &node) :
+fRoot(node) {
+	auto vector = toVector(node.fRef);
+	std::vector<Node*> roots;
+	if (vector) {
+		for (auto &element : vector->elements) {
+			roots.push_back(element.get());
+		}
+	}
+	else {
+		roots.push_back(node.fRef.get());
+	}
+
+	std::unordered_map<Node*, size_t> indices;
+	std::vector<std::pair<Node*, size_t>> frames;
+	size_t maxArguments = 0;
+	for (auto root : roots) {
+		if (!indices.count(root)) {
+			frames.push_back({root, 0});
+		}
+		while (!frames.empty()) {
+			auto &frame = frames.back();
+			auto current = frame.first;
+			size_t count = current->getChildCount();
+			if (frame.second < count) {
+				auto child = current->getChild(frame.second++).get();
+				if (!indices.count(child)) {
+					frames.push_back({child, 0});
+				}
+				continue;
+			}
+			frames.pop_back();
+			if (indices.count(current)) {
+				continue;
+			}
+			for (size_t i = 0; i < count; i++) {
+				fArguments.push_back(indices[current->getChild(i).get()]);
+			}
+			maxArguments = std::max(maxArguments, count);
+			indices[current] = fEntries.size();
+			fEntries.push_back(current);
+		}
+		fComponents.push_back(indices[root]);
+	}
+
+	fValues.resize(fEntries.size() * kBatchSize);
+	fScratch.resize(maxArguments * kBatchSize);
+}
+
+// Every entry once per block, the children gathered into consecutive blocks as evaluateBatchLocal() expects
+void ComponentEvaluator::evaluate(const float *x, float *result, size_t count) {
+	for (size_t i = 0; i < count; i += kBatchSize) {
+		size_t points = std::min(kBatchSize, count - i);
+		const size_t *argument = fArguments.data();
+		for (size_t index = 0; index < fEntries.size(); index++) {
+			size_t children = fEntries[index]->getChildCount();
+			for (size_t j = 0; j < children; j++) {
+				const float *block = fValues.data() + *argument++ * kBatchSize;
+				std::copy(block, block + points, fScratch.data() + j * kBatchSize);
+			}
+			fEntries[index]->evaluateBatchLocal(x + i, fScratch.data(), fValues.data() + index * kBatchSize, points);
+		}
+		for (size_t j = 0; j < fComponents.size(); j++) {
+			const float *block = fValues.data() + fComponents[j] * kBatchSize;
+			std::copy(block, block + points, result + j * count + i);
+		}
+	}
+}
+
+JacobianEvaluator::JacobianEvaluator(const NodeRef &node, const std::vector<NodeRef> &parameters) :
+fRoot(node),
+fParameters(parameters.size(), SIZE_MAX) {
+	std::unordered_map<Node*, size_t> parameterIndices;
+	for (size_t i = 0; i < parameters.size(); i++) {
+		parameterIndices[parameters[i].fRef.get()] = i;
+	}
+
+	std::unordered_map<Node*, size_t> indices;
+	std::vector<std::pair<Node*, size_t>> frames{{node.fRef.get(), 0}};
+	size_t maxArguments = 0;
+	while (!frames.empty()) {
+		auto &frame = frames.back();
+		auto current = frame.first;
+		size_t count = current->getChildCount();
+		if (frame.second < count) {
+			auto child = current->getChild(frame.second++).get();
+			if (!indices.count(child)) {
+				frames.push_back({child, 0});
+			}
+			continue;
+		}
+		frames.pop_back();
+		if (indices.count(current)) {
+			continue;
+		}
+		size_t index = fEntries.size();
+		bool dependent = false;
+		fEntries.push_back({current, fArguments.size(), false});
+		for (size_t i = 0; i < count; i++) {
+			size_t argument = indices[current->getChild(i).get()];
+			fArguments.push_back(argument);
+			dependent = dependent || fEntries[argument].dependent;
+		}
+		auto parameter = parameterIndices.find(current);
+		if (parameter != parameterIndices.end()) {
+			fParameters[parameter->second] = index;
+			dependent = true;
+		}
+		fEntries[index].dependent = dependent;
+		maxArguments = std::max(maxArguments, count);
+		indices[current] = index;
+	}
+
+	auto vector = toVector(node.fRef);
+	if (vector) {
+		for (auto &element : vector->elements) {
+			fComponents.push_back(indices[element.get()]);
+		}
+	}
+	else {
+		fComponents.push_back(fEntries.size() - 1);
+	}
+
+	fValues.resize(fEntries.size());
+	fPartials.resize(fArguments.size());
+	fDerivatives.resize(fEntries.size());
+	fScratch.resize(maxArguments);
+}
+
+// Values of all entries, and the partials of those depending on a parameter
+void JacobianEvaluator::evaluateEntries(float x) {
+	for (size_t index = 0; index < fEntries.size(); index++) {
+		auto &entry = fEntries[index];
+		size_t count = entry.node->getChildCount();
+		for (size_t i = 0; i < count; i++) {
+			fScratch[i] = fValues[fArguments[entry.firstArgument + i]];
+		}
+		fValues[index] = entry.node->evaluateLocal(x, fScratch.data());
+		if (entry.dependent && count) {
+			entry.node->partialsLocal(x, fScratch.data(), fValues[index], fPartials.data() + entry.firstArgument);
+		}
+	}
+}
+
+void JacobianEvaluator::evaluate(float x, float *result) {
+	evaluateEntries(x);
+	for (size_t i = 0; i < fComponents.size(); i++) {
+		result[i] = fValues[fComponents[i]];
+	}
+}
+
+/*
+	Children not depending on a parameter are skipped rather than multiplied
+	by a zero tangent, their partials may be NaN, ln of a negative base for
+	a constant exponent for example
+*/
+void JacobianEvaluator::jvp(float x, const float *tangent, float *result) {
+	evaluateEntries(x);
+	std::fill(fDerivatives.begin(), fDerivatives.end(), 0.0f);
+	for (size_t i = 0; i < fParameters.size(); i++) {
+		if (fParameters[i] != SIZE_MAX) {
+			fDerivatives[fParameters[i]] = tangent[i];
+		}
+	}
+	for (size_t index = 0; index < fEntries.size(); index++) {
+		auto &entry = fEntries[index];
+		size_t count = entry.node->getChildCount();
+		if (!entry.dependent || !count) {
+			continue;
+		}
+		float derivative = 0.0f;
+		for (size_t i = 0; i < count; i++) {
+			size_t argument = fArguments[entry.firstArgument + i];
+			if (fEntries[argument].dependent) {
+				derivative += fPartials[entry.firstArgument + i] * fDerivatives[argument];
+			}
+		}
+		fDerivatives[index] = derivative;
+	}
+	for (size_t i = 0; i < fComponents.size(); i++) {
+		result[i] = fDerivatives[fComponents[i]];
+	}
+}
+
+void JacobianEvaluator::vjp(float x, const float *cotangent, float *result) {
+	evaluateEntries(x);
+	std::fill(fDerivatives.begin(), fDerivatives.end(), 0.0f);
+	for (size_t i = 0; i < fComponents.size(); i++) {
+		fDerivatives[fComponents[i]] += cotangent[i];
+	}
+	for (size_t index = fEntries.size(); index > 0; index--) {
+		auto &entry = fEntries[index - 1];
+		float adjoint = fDerivatives[index - 1];
+		if (!entry.dependent || adjoint == 0.0f) {
+			continue;
+		}
+		for (size_t i = 0; i < entry.node->getChildCount(); i++) {
+			size_t argument = fArguments[entry.firstArgument + i];
+			if (fEntries[argument].dependent) {
+				fDerivatives[argument] += fPartials[entry.firstArgument + i] * adjoint;
+			}
+		}
+	}
+	for (size_t i = 0; i < fParameters.size(); i++) {
+		result[i] = fParameters[i] != SIZE_MAX ? fDerivatives[fParameters[i]] : 0.0f;
+	}
+}